@@ -8,7 +8,35 @@ project "Compiler"
     location "build/Compiler"
     kind "ConsoleApp"
     language "C++"
-    files { "src/**.h", "src/**.cpp" }
+    files { "src/Compiler/**.h", "src/Compiler/**.cpp", "src/Utils/**.h", "src/Utils/**.cpp", "src/Driver/**.h", "src/Driver/**.cpp" }
+
+    filter { "configurations:Debug" }
+        defines { "DEBUG" }
+        flags { "Symbols" }
+
+    filter "configurations:Release"
+        defines "NDEBUG"
+        optimize "On"
+
+project "UnitTest"
+    location "build/UnitTest"
+    kind "ConsoleApp"
+    language "C++"
+    files { "src/Compiler/**.h", "src/Compiler/**.cpp", "src/Utils/**.h", "src/Utils/**.cpp", "src/UnitTest/**.h", "src/UnitTest/**.cpp" }
+
+    filter { "configurations:Debug" }
+        defines { "DEBUG" }
+        flags { "Symbols" }
+
+    filter "configurations:Release"
+        defines "NDEBUG"
+        optimize "On"
+
+project "Benchmark"
+    location "build/Benchmark"
+    kind "ConsoleApp"
+    language "C++"
+    files { "src/Compiler/**.h", "src/Compiler/**.cpp", "src/Utils/**.h", "src/Utils/**.cpp", "src/Benchmark/**.h", "src/Benchmark/**.cpp" }
 
     filter { "configurations:Debug" }
         defines { "DEBUG" }
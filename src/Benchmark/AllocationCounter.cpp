@@ -0,0 +1,33 @@
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "Benchmark/Benchmark.h"
+
+namespace
+{
+    std::atomic<size_t> allocationCount(0);
+}
+
+// replaces the global allocation of the benchmark program to count it
+void * operator new(size_t size)
+{
+    allocationCount++;
+    void * memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void * memory) noexcept
+{
+    std::free(memory);
+}
+
+namespace minimoe
+{
+    size_t AllocationCount()
+    {
+        return allocationCount;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef MINIMOE_BENCHMARK_H
+#define MINIMOE_BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <iostream>
+
+namespace minimoe
+{
+    // run func repeat times and return the average time of one run in milliseconds
+    template<class Func>
+    double MeasureMilliseconds(size_t repeat, Func func)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < repeat; i++)
+            func();
+        auto finish = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(finish - start).count() / repeat;
+    }
+
+    inline void ReportBenchmark(const std::string & name, double milliseconds)
+    {
+        std::cout << name << " : " << milliseconds << " ms" << std::endl;
+    }
+
+    // count of the global operator new calls since the benchmark started
+    size_t AllocationCount();
+
+    // keep the optimizer from removing the benchmarked code
+    template<class T>
+    void DoNotOptimize(const T & value)
+    {
+        static volatile const void * sink;
+        sink = &value;
+    }
+
+}
+
+#endif
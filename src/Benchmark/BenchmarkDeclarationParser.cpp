@@ -0,0 +1,119 @@
+#include <string>
+
+#include "Compiler/Lexer/Lexer.h"
+#include "Compiler/Parser/DeclarationParser.h"
+#include "Compiler/Parser/FunctionBody.h"
+#include "Utils/ThreadPool.h"
+#include "Benchmark/Benchmark.h"
+
+using std::string;
+using namespace minimoe;
+
+namespace
+{
+    // types with many members, tags and functions with long bodies, the declarations parsed line by line
+    string GenerateDeclarationCode()
+    {
+        string code = "module benchmark\n";
+        for (size_t type = 0; type < 1000; type++)
+        {
+            code += "type Type" + std::to_string(type) + "\n";
+            for (size_t member = 0; member < 40; member++)
+                code += "    member" + std::to_string(member) + "\n";
+            code += "end\n";
+        }
+        for (size_t tag = 0; tag < 20000; tag++)
+            code += "tag Tag" + std::to_string(tag) + "\n";
+        for (size_t function = 0; function < 2000; function++)
+        {
+            code += "phrase Sum" + std::to_string(function) + "(low)To(high)\n";
+            for (size_t line = 0; line < 20; line++)
+                code += "    result = result + low * high - " + std::to_string(line) + "\n";
+            code += "end\n";
+        }
+        return code;
+    }
+
+    void BenchmarkParseDeclarations()
+    {
+        auto codeFile = CodeFile::Parse(GenerateDeclarationCode());
+
+        const size_t repeat = 10;
+        size_t declarationCount = 0;
+        size_t allocationCount = AllocationCount();
+        double parse = MeasureMilliseconds(repeat, [&](){
+            CompileError::List errors;
+            auto module = Module::Parse(codeFile, errors);
+            declarationCount = module->types.size() + module->tags.size() + module->functions.size();
+        });
+        allocationCount = (AllocationCount() - allocationCount) / repeat;
+        DoNotOptimize(declarationCount);
+
+        std::cout << "parse " << codeFile->lines.size() << " lines of " << declarationCount << " declarations, "
+            << allocationCount << " allocations" << std::endl;
+        ReportBenchmark("    module", parse);
+    }
+
+    void BenchmarkParseDeclarationsParallel()
+    {
+        auto codeFile = CodeFile::Parse(GenerateDeclarationCode());
+        ThreadPool pool;
+
+        size_t declarationCount = 0;
+        double serial = MeasureMilliseconds(10, [&](){
+            CompileError::List errors;
+            declarationCount += Module::Parse(codeFile, errors)->functions.size();
+        });
+        double parallel = MeasureMilliseconds(10, [&](){
+            CompileError::List errors;
+            declarationCount += Module::ParseParallel(codeFile, pool, errors)->functions.size();
+        });
+        DoNotOptimize(declarationCount);
+
+        std::cout << "parse the declarations on " << pool.Size() << " threads" << std::endl;
+        ReportBenchmark("    serial", serial);
+        ReportBenchmark("    parallel", parallel);
+    }
+
+    void BenchmarkMaterializeBodies()
+    {
+        auto codeFile = CodeFile::Parse(GenerateDeclarationCode());
+
+        // parse the module, then the bodies of every step-th function
+        auto ParseModuleAndBodies = [&](size_t step){
+            CompileError::List errors;
+            auto module = Module::Parse(codeFile, errors);
+            SymbolStack stack;
+            stack.arena = module->arena;
+            auto item = std::make_shared<SymbolStackItem>();
+            item->LoadPredefinedSymbol();
+            item->functionTables = module->functions;
+            stack.Push(item);
+            size_t statementCount = 0;
+            for (size_t i = 0; i < module->functions.size(); i += step)
+                statementCount += MaterializeBody(module->functions[i], stack)->statements.size();
+            stack.Pop();
+            return statementCount;
+        };
+
+        size_t statementCount = 0;
+        double lazy = MeasureMilliseconds(5, [&](){
+            statementCount += ParseModuleAndBodies(200);
+        });
+        double eager = MeasureMilliseconds(5, [&](){
+            statementCount += ParseModuleAndBodies(1);
+        });
+        DoNotOptimize(statementCount);
+
+        std::cout << "parse the module and the bodies of its functions" << std::endl;
+        ReportBenchmark("    every 200th body", lazy);
+        ReportBenchmark("    all bodies", eager);
+    }
+}
+
+void InvokeDeclarationParserBenchmark()
+{
+    BenchmarkParseDeclarations();
+    BenchmarkParseDeclarationsParallel();
+    BenchmarkMaterializeBodies();
+}
@@ -0,0 +1,182 @@
+#include <string>
+#include <vector>
+#include <random>
+
+#include "Compiler/Lexer/Lexer.h"
+#include "Compiler/Parser/ExpressionParser.h"
+#include "Compiler/Parser/FlatExpression.h"
+#include "Benchmark/Benchmark.h"
+
+using std::string;
+using namespace minimoe;
+
+namespace
+{
+    // nested arithmetic, logic, lists and function invoking, one expression a line
+    class ExpressionGenerator
+    {
+    public:
+        ExpressionGenerator()
+            : random(233)
+        {}
+
+        string Generate(size_t depth)
+        {
+            if (depth == 0 || random() % 4 == 0)
+                return Primitive();
+            switch (random() % 6)
+            {
+            case 0:
+                return "(" + Generate(depth - 1) + ")";
+            case 1:
+                return "-" + Primitive();
+            case 2:
+                return "Sum(" + Generate(depth - 1) + ")To(" + Generate(depth - 1) + ")";
+            case 3:
+                return "(" + Generate(depth - 1) + ", " + Generate(depth - 1) + ")";
+            default:
+                {
+                    const char * operators[] = { " + ", " - ", " * ", " / ", " < ", " == ", " and ", " or " };
+                    return Generate(depth - 1) + operators[random() % 8] + Generate(depth - 1);
+                }
+            }
+        }
+
+    private:
+        string Primitive()
+        {
+            switch (random() % 4)
+            {
+            case 0: return std::to_string(random() % 1000);
+            case 1: return "\"text\"";
+            case 2: return "true";
+            default: return "value" + std::to_string(random() % 8);
+            }
+        }
+
+        std::mt19937 random;
+    };
+
+    string GenerateExpressionCode()
+    {
+        ExpressionGenerator generator;
+        string code;
+        for (size_t i = 0; i < 20000; i++)
+            code += generator.Generate(5) + "\n";
+        return code;
+    }
+
+    SymbolStackItem::Ptr MakeBenchmarkSymbols()
+    {
+        auto item = std::make_shared<SymbolStackItem>();
+        item->LoadPredefinedSymbol();
+        for (size_t i = 0; i < 8; i++)
+        {
+            auto declaration = std::make_shared<VariableDeclaration>();
+            declaration->type = Type::Integer;
+            item->addSymbol(declaration, "value" + std::to_string(i));
+        }
+        item->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+            ->name("Sum")->arg(FunctionArgumentType::Normal, "from")
+            ->name("To")->arg(FunctionArgumentType::Normal, "to"));
+        return item;
+    }
+
+    void BenchmarkParseExpressions()
+    {
+        auto codeFile = CodeFile::Parse(GenerateExpressionCode());
+        auto item = MakeBenchmarkSymbols();
+
+        const size_t repeat = 5;
+        size_t parsedCount = 0;
+        size_t allocationCount = AllocationCount();
+        double parse = MeasureMilliseconds(repeat, [&](){
+            // the trees are dropped with the stack
+            SymbolStack stack;
+            stack.Push(item);
+            Expression::List expressions;
+            for (auto & line : codeFile->lines)
+            {
+                CompileError::List errors;
+                auto head = line.begin();
+                auto exp = stack.ParseExpression(head, line.end(), errors);
+                parsedCount += exp != nullptr;
+                expressions.push_back(exp);
+            }
+            stack.Pop();
+        });
+        allocationCount = (AllocationCount() - allocationCount) / repeat;
+        DoNotOptimize(parsedCount);
+
+        std::cout << "parse " << codeFile->lines.size() << " expressions, "
+            << parsedCount / repeat << " valid, " << allocationCount << " allocations" << std::endl;
+        ReportBenchmark("    parse and drop", parse);
+    }
+
+    size_t CountLiterals(Expression::Ptr exp)
+    {
+        switch (exp->expressionType)
+        {
+        case ExpressionType::Literal:
+            return 1;
+        case ExpressionType::Unary:
+            return CountLiterals(static_cast<UnaryExpression*>(exp)->operand);
+        case ExpressionType::Binary:
+            return CountLiterals(static_cast<BinaryExpression*>(exp)->leftOperand)
+                + CountLiterals(static_cast<BinaryExpression*>(exp)->rightOperand);
+        case ExpressionType::FunctionInvoke:
+            {
+                size_t count = 0;
+                for (auto argument : static_cast<FunctionInvokeExpression*>(exp)->arguments)
+                    count += CountLiterals(argument);
+                return count;
+            }
+        case ExpressionType::List:
+            {
+                size_t count = 0;
+                for (auto element : static_cast<ListExpression*>(exp)->elements)
+                    count += CountLiterals(element);
+                return count;
+            }
+        default:
+            return 0;
+        }
+    }
+
+    void BenchmarkWalkExpressions()
+    {
+        auto codeFile = CodeFile::Parse(GenerateExpressionCode());
+        SymbolStack stack;
+        stack.Push(MakeBenchmarkSymbols());
+        Expression::List expressions;
+        FlatExpressionTree tree;
+        for (auto & line : codeFile->lines)
+        {
+            CompileError::List errors;
+            auto head = line.begin();
+            expressions.push_back(stack.ParseExpression(head, line.end(), errors));
+            tree.Append(expressions.back());
+        }
+
+        size_t literalCount = 0;
+        double pointerTree = MeasureMilliseconds(20, [&](){
+            for (auto exp : expressions)
+                literalCount += CountLiterals(exp);
+        });
+        double flatTree = MeasureMilliseconds(20, [&](){
+            for (FlatExpressionTree::NodeIndex node = 0; node < tree.Size(); node++)
+                literalCount += tree.Type(node) == ExpressionType::Literal;
+        });
+        DoNotOptimize(literalCount);
+
+        std::cout << "count literals of " << tree.Size() << " expression nodes" << std::endl;
+        ReportBenchmark("    pointer tree", pointerTree);
+        ReportBenchmark("    flat tree", flatTree);
+    }
+}
+
+void InvokeExpressionParserBenchmark()
+{
+    BenchmarkParseExpressions();
+    BenchmarkWalkExpressions();
+}
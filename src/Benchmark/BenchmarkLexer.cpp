@@ -0,0 +1,179 @@
+#include <string>
+#include <vector>
+#include <random>
+
+#include "Compiler/Lexer/Lexer.h"
+#include "Compiler/Lexer/CharScanner.h"
+#include "Utils/ThreadPool.h"
+#include "Benchmark/Benchmark.h"
+
+using std::string;
+using namespace minimoe;
+
+namespace
+{
+    // the classification used before ClassifyIdentifier, kept as the baseline
+    CodeTokenType ClassifyIdentifierByComparison(StringView value)
+    {
+        return
+            value == "module" ? CodeTokenType::Module :
+            value == "using" ? CodeTokenType::Using :
+            value == "phrase" ? CodeTokenType::Phrase :
+            value == "sentence" ? CodeTokenType::Sentence :
+            value == "block" ? CodeTokenType::Block :
+            value == "type" ? CodeTokenType::Type :
+            value == "cps" ? CodeTokenType::CPS :
+            value == "category" ? CodeTokenType::Category :
+            value == "deferred" ? CodeTokenType::Deferred :
+            value == "blockbody" ? CodeTokenType::BlockBody :
+            value == "assignable" ? CodeTokenType::Assignable :
+            value == "list" ? CodeTokenType::List :
+            value == "end" ? CodeTokenType::End :
+            value == "and" ? CodeTokenType::And :
+            value == "or" ? CodeTokenType::Or :
+            value == "not" ? CodeTokenType::Not :
+            value == "tag" ? CodeTokenType::Tag :
+            value == "var" ? CodeTokenType::Var :
+            CodeTokenType::Identifier;
+    }
+
+    // identifier dense code, about one keyword in eight words
+    string GenerateIdentifierCode(size_t lineCount)
+    {
+        const char * words[] = {
+            "value", "index", "count", "result", "total", "number", "item", "items",
+            "name", "node", "left", "right", "parent", "child", "size", "buffer",
+            "and", "or", "not", "end",
+        };
+        const size_t wordCount = sizeof(words) / sizeof(words[0]);
+        std::mt19937 random(233);
+        string code;
+        for (size_t i = 0; i < lineCount; i++)
+        {
+            for (size_t j = 0; j < 10; j++)
+            {
+                code += words[random() % wordCount];
+                code += (j == 9 ? '\n' : ' ');
+            }
+        }
+        return code;
+    }
+
+    // long comments and strings, like the generated modules
+    string GenerateCommentCode(size_t lineCount)
+    {
+        string code;
+        for (size_t i = 0; i < lineCount; i++)
+        {
+            if (i % 2 == 0)
+                code += "-- this is a long comment line describing the generated declaration below it\n";
+            else
+                code += "    print(\"a string literal which is long enough to cross several blocks\")\n";
+        }
+        return code;
+    }
+
+    void BenchmarkCharScanner()
+    {
+        string code = GenerateCommentCode(20000);
+        const char * begin = code.data();
+        const char * end = begin + code.size();
+        const char * names[] = { "scalar", "SSE2", "AVX2" };
+
+        std::cout << "scan " << code.size() << " bytes of comments and strings" << std::endl;
+        for (int level = static_cast<int>(SimdLevel::Scalar); level <= static_cast<int>(DetectSimdLevel()); level++)
+        {
+            auto & scanner = GetCharScanner(static_cast<SimdLevel>(level));
+            size_t lineCount = 0;
+            double scan = MeasureMilliseconds(20, [&](){
+                for (const char * it = begin; it != end; ++it)
+                {
+                    it = scanner.FindLineEnd(it, end);
+                    lineCount++;
+                    if (it == end) break;
+                }
+            });
+            DoNotOptimize(lineCount);
+            ReportBenchmark(string("    FindLineEnd ") + names[level], scan);
+        }
+
+        size_t tokenCount = 0;
+        double stateMachine = MeasureMilliseconds(10, [&](){
+            tokenCount += CodeFile::Parse(code, LexerEngine::StateMachine)->tokens.size();
+        });
+        double table = MeasureMilliseconds(10, [&](){
+            tokenCount += CodeFile::Parse(code, LexerEngine::TableDriven)->tokens.size();
+        });
+        DoNotOptimize(tokenCount);
+        std::cout << "lex " << code.size() << " bytes of comments and strings with "
+            << names[static_cast<int>(DetectSimdLevel())] << " scanner" << std::endl;
+        ReportBenchmark("    state machine", stateMachine);
+        ReportBenchmark("    table driven", table);
+    }
+
+    void BenchmarkKeywordClassification()
+    {
+        auto codeFile = CodeFile::Parse(GenerateIdentifierCode(20000));
+        std::vector<StringView> words;
+        for (auto & token : codeFile->tokens)
+            words.push_back(token.value);
+
+        size_t keywordCount = 0;
+        double comparison = MeasureMilliseconds(20, [&](){
+            for (auto & word : words)
+                keywordCount += ClassifyIdentifierByComparison(word) != CodeTokenType::Identifier;
+        });
+        double dispatch = MeasureMilliseconds(20, [&](){
+            for (auto & word : words)
+                keywordCount += ClassifyIdentifier(word) != CodeTokenType::Identifier;
+        });
+        DoNotOptimize(keywordCount);
+
+        std::cout << "classify " << words.size() << " identifiers" << std::endl;
+        ReportBenchmark("    string comparison chain", comparison);
+        ReportBenchmark("    length and first char dispatch", dispatch);
+    }
+
+    void BenchmarkLexIdentifiers()
+    {
+        string code = GenerateIdentifierCode(20000);
+        size_t tokenCount = 0;
+        double stateMachine = MeasureMilliseconds(10, [&](){
+            tokenCount += CodeFile::Parse(code, LexerEngine::StateMachine)->tokens.size();
+        });
+        double table = MeasureMilliseconds(10, [&](){
+            tokenCount += CodeFile::Parse(code, LexerEngine::TableDriven)->tokens.size();
+        });
+        DoNotOptimize(tokenCount);
+
+        std::cout << "lex " << code.size() << " bytes of identifier dense code" << std::endl;
+        ReportBenchmark("    state machine", stateMachine);
+        ReportBenchmark("    table driven", table);
+    }
+
+    void BenchmarkParseParallel()
+    {
+        string code = GenerateIdentifierCode(200000);
+        ThreadPool pool;
+        size_t tokenCount = 0;
+        double serial = MeasureMilliseconds(5, [&](){
+            tokenCount += CodeFile::Parse(code)->tokens.size();
+        });
+        double parallel = MeasureMilliseconds(5, [&](){
+            tokenCount += CodeFile::ParseParallel(string(code), pool)->tokens.size();
+        });
+        DoNotOptimize(tokenCount);
+
+        std::cout << "lex " << code.size() << " bytes on " << pool.Size() << " threads" << std::endl;
+        ReportBenchmark("    serial", serial);
+        ReportBenchmark("    parallel", parallel);
+    }
+}
+
+void InvokeLexerBenchmark()
+{
+    BenchmarkKeywordClassification();
+    BenchmarkLexIdentifiers();
+    BenchmarkCharScanner();
+    BenchmarkParseParallel();
+}
@@ -0,0 +1,132 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+#include "Compiler/Project.h"
+#include "Compiler/ModuleInterface.h"
+#include "Utils/ThreadPool.h"
+#include "Benchmark/Benchmark.h"
+
+using std::string;
+using namespace minimoe;
+
+namespace
+{
+    // modules using one or two of the 20 modules before them, the functions call the functions of the used modules
+    std::vector<string> GenerateProjectCode(size_t moduleCount)
+    {
+        std::mt19937 random(233);
+        std::vector<string> modules;
+        for (size_t i = 0; i < moduleCount; i++)
+        {
+            string name = "Module" + std::to_string(i);
+            string code = "module " + name + "\n";
+            std::vector<string> usings;
+            for (size_t u = 0; i > 0 && u < 2; u++)
+            {
+                size_t used = i - 1 - random() % std::min<size_t>(i, 20);
+                string usedName = "Module" + std::to_string(used);
+                if (usings.empty() || usings[0] != usedName)
+                    usings.push_back(usedName);
+            }
+            for (auto & usi : usings)
+                code += "using " + usi + "\n";
+            for (size_t function = 0; function < 10; function++)
+            {
+                code += "phrase " + name + "Function" + std::to_string(function) + "(value)\n";
+                for (size_t line = 0; line < 10; line++)
+                {
+                    string callee = usings.empty() ? "value" : usings[line % usings.size()] + "Function" + std::to_string(line) + "(value)";
+                    code += "    result = result + " + callee + " * " + std::to_string(line) + "\n";
+                }
+                code += "end\n";
+            }
+            modules.push_back(code);
+        }
+        return modules;
+    }
+
+    void BenchmarkBuildProject()
+    {
+        auto modules = GenerateProjectCode(500);
+        auto Build = [&](ThreadPool & pool){
+            Project project;
+            for (size_t i = 0; i < modules.size(); i++)
+                project.AddSource("Module" + std::to_string(i) + ".moe", modules[i]);
+            project.Build(pool);
+            return project;
+        };
+
+        ThreadPool serialPool(1);
+        ThreadPool pool;
+        Project serialProject, parallelProject;
+        double serial = MeasureMilliseconds(1, [&](){ serialProject = Build(serialPool); });
+        double parallel = MeasureMilliseconds(1, [&](){ parallelProject = Build(pool); });
+
+        std::cout << "build " << modules.size() << " modules on " << pool.Size() << " threads, critical path of "
+            << parallelProject.criticalPath.size() << " modules" << std::endl;
+        ReportBenchmark("    1 thread", serial);
+        ReportBenchmark("    " + std::to_string(pool.Size()) + " threads", parallel);
+        ReportBenchmark("    work", parallelProject.workTime);
+        ReportBenchmark("    critical path", parallelProject.criticalPathTime);
+    }
+
+    void BenchmarkModuleInterface()
+    {
+        auto modules = GenerateProjectCode(500);
+        string & code = modules.back();
+
+        size_t declarationCount = 0;
+        Module::Ptr module;
+        double parse = MeasureMilliseconds(100, [&](){
+            CompileError::List errors;
+            module = Module::Parse(CodeFile::Parse(code), errors);
+            declarationCount += module->functions.size();
+        });
+        auto bytes = ModuleInterface::Make(module, 0)->Serialize();
+        double load = MeasureMilliseconds(100, [&](){
+            declarationCount += ModuleInterface::Load(bytes.data(), bytes.size())->module->functions.size();
+        });
+        DoNotOptimize(declarationCount);
+
+        std::cout << "get the declarations of a module of " << code.size() << " bytes, "
+            << bytes.size() << " bytes of interface" << std::endl;
+        ReportBenchmark("    lex and parse", parse);
+        ReportBenchmark("    load interface", load);
+    }
+
+    void BenchmarkBuildProjectWithCache()
+    {
+        auto modules = GenerateProjectCode(500);
+        ThreadPool pool;
+        std::vector<string> interfacePaths;
+        auto Build = [&](){
+            Project project;
+            project.cacheDirectory = ".";
+            for (size_t i = 0; i < modules.size(); i++)
+                project.AddSource("Module" + std::to_string(i) + ".moe", modules[i]);
+            project.Build(pool);
+            interfacePaths.clear();
+            for (auto & unit : project.units)
+                interfacePaths.push_back(unit->interfacePath);
+        };
+
+        double cold = MeasureMilliseconds(1, Build);
+        double warm = MeasureMilliseconds(1, Build);
+        for (auto & path : interfacePaths)
+            std::remove(path.c_str());
+
+        std::cout << "build " << modules.size() << " modules with the interface cache" << std::endl;
+        ReportBenchmark("    save interfaces", cold);
+        ReportBenchmark("    load interfaces", warm);
+    }
+}
+
+void InvokeProjectBenchmark()
+{
+    BenchmarkBuildProject();
+    BenchmarkModuleInterface();
+    BenchmarkBuildProjectWithCache();
+}
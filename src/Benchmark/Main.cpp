@@ -0,0 +1,13 @@
+extern void InvokeLexerBenchmark();
+extern void InvokeExpressionParserBenchmark();
+extern void InvokeDeclarationParserBenchmark();
+extern void InvokeProjectBenchmark();
+
+int main()
+{
+    InvokeLexerBenchmark();
+    InvokeExpressionParserBenchmark();
+    InvokeDeclarationParserBenchmark();
+    InvokeProjectBenchmark();
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "Compiler/Lexer/Lexer.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    using std::string;
+
+    string CompileError::Message() const
+    {
+        switch (errorType)
+        {
+        case CompileErrorType::Lexer_UnexpectedChar:
+            return "illegal char found: '" + token.value.ToString() + "'";
+        case CompileErrorType::Lexer_InvalidFloat:
+            return "'.' should be followed by digit";
+        case CompileErrorType::Lexer_InCompleteString:
+            return "incomplete string, multiple line string is not allowed";
+        case CompileErrorType::Lexer_InvalidEscapeChar:
+            return "invalid escape char found in string literal";
+        case CompileErrorType::Parser_NoMoreToken:
+            return "expect token but no more token found";
+        case CompileErrorType::Parser_CloseBracketNotFound:
+            return "expect close bracket but not found";
+        case CompileErrorType::Parser_CanNotResolveSymbol:
+            return "can't resolve symbol: " + token.value.ToString();
+        case CompileErrorType::Parser_UnExpectedTokenType:
+            return "expect token type " + TokenTypeToString(static_cast<CodeTokenType>(argument))
+                + " but got " + TokenTypeToString(token.type);
+        case CompileErrorType::Parser_WrongFunctionName:
+            return "expect function name fragment \"" + StringInterner::Instance().Lookup(argument).ToString()
+                + "\" but get\"" + token.value.ToString() + "\"";
+        case CompileErrorType::Parser_OneElementListShouldEndWithComma:
+            return "In one element List, there should be a comma after the element";
+        case CompileErrorType::Parser_NotOneElementListShouldNotEndWithComma:
+            return "List with more than one element should not end with comma";
+        case CompileErrorType::Parser_ExpressionTooDeep:
+            return "expression is nested too deeply";
+        case CompileErrorType::Parser_NoMoreLine:
+            return "no more line found";
+        case CompileErrorType::Parser_VarNotInit:
+            return "variable is not initialized";
+        case CompileErrorType::Parser_CanNotParseLeftToken:
+            return "can't parse the left token in this line";
+        case CompileErrorType::Parser_InvalidArgumentDeclaration:
+            return "argument should be a single identifier or with a qualifier";
+        case CompileErrorType::Parser_ExpectEndForFunctionDeclaration:
+            return "function declaration should be end with \"end\"";
+        case CompileErrorType::Project_ModuleNotFound:
+            return "can't find module: " + token.value.ToString();
+        case CompileErrorType::Project_DuplicateModule:
+            return "module is defined more than once: " + token.value.ToString();
+        case CompileErrorType::Project_CyclicUsing:
+            return "using module in a cycle: " + token.value.ToString();
+        }
+        ERRORMSG("invalid CompileErrorType");
+        return "";
+    }
+}
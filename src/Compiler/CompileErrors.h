@@ -17,12 +17,17 @@ namespace minimoe
         Parser_WrongFunctionName,
         Parser_OneElementListShouldEndWithComma,
         Parser_NotOneElementListShouldNotEndWithComma,
+        Parser_ExpressionTooDeep,
 
         Parser_NoMoreLine,
         Parser_VarNotInit,
         Parser_CanNotParseLeftToken,
         Parser_InvalidArgumentDeclaration,
         Parser_ExpectEndForFunctionDeclaration,
+
+        Project_ModuleNotFound,
+        Project_DuplicateModule,
+        Project_CyclicUsing,
     };
 }
 
@@ -0,0 +1,218 @@
+#include "Compiler/Lexer/CharScanner.h"
+#include "Utils/Debug.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define MINIMOE_SIMD_X64
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 functions are compiled for AVX2 but only called after checking the cpu
+#if defined(MINIMOE_SIMD_X64) && (defined(__GNUC__) || defined(__clang__))
+#define MINIMOE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MINIMOE_TARGET_AVX2
+#endif
+
+namespace minimoe
+{
+    namespace
+    {
+        /***************
+        Scalar
+        ***************/
+        const char * FindLineEndScalar(const char * begin, const char * end)
+        {
+            while (begin != end && *begin != '\n')
+                ++begin;
+            return begin;
+        }
+
+        const char * FindStringEndScalar(const char * begin, const char * end)
+        {
+            while (begin != end && *begin != '"' && *begin != '\\' && *begin != '\n')
+                ++begin;
+            return begin;
+        }
+
+        const char * SkipBlanksScalar(const char * begin, const char * end)
+        {
+            while (begin != end && (*begin == ' ' || *begin == '\t'))
+                ++begin;
+            return begin;
+        }
+
+#ifdef MINIMOE_SIMD_X64
+        inline unsigned CountTrailingZero(unsigned mask)
+        {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        /***************
+        SSE2
+        ***************/
+        const char * FindLineEndSSE2(const char * begin, const char * end)
+        {
+            const __m128i newLine = _mm_set1_epi8('\n');
+            for (; end - begin >= 16; begin += 16)
+            {
+                __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, newLine));
+                if (mask != 0)
+                    return begin + CountTrailingZero(mask);
+            }
+            return FindLineEndScalar(begin, end);
+        }
+
+        const char * FindStringEndSSE2(const char * begin, const char * end)
+        {
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i newLine = _mm_set1_epi8('\n');
+            for (; end - begin >= 16; begin += 16)
+            {
+                __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                __m128i found = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)),
+                    _mm_cmpeq_epi8(chars, newLine));
+                unsigned mask = _mm_movemask_epi8(found);
+                if (mask != 0)
+                    return begin + CountTrailingZero(mask);
+            }
+            return FindStringEndScalar(begin, end);
+        }
+
+        const char * SkipBlanksSSE2(const char * begin, const char * end)
+        {
+            const __m128i space = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            for (; end - begin >= 16; begin += 16)
+            {
+                __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(chars, space), _mm_cmpeq_epi8(chars, tab));
+                unsigned mask = ~_mm_movemask_epi8(blank) & 0xFFFF;
+                if (mask != 0)
+                    return begin + CountTrailingZero(mask);
+            }
+            return SkipBlanksScalar(begin, end);
+        }
+
+        /***************
+        AVX2
+        ***************/
+        MINIMOE_TARGET_AVX2
+        const char * FindLineEndAVX2(const char * begin, const char * end)
+        {
+            const __m256i newLine = _mm256_set1_epi8('\n');
+            for (; end - begin >= 32; begin += 32)
+            {
+                __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, newLine));
+                if (mask != 0)
+                    return begin + CountTrailingZero(mask);
+            }
+            return FindLineEndSSE2(begin, end);
+        }
+
+        MINIMOE_TARGET_AVX2
+        const char * FindStringEndAVX2(const char * begin, const char * end)
+        {
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i newLine = _mm256_set1_epi8('\n');
+            for (; end - begin >= 32; begin += 32)
+            {
+                __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                __m256i found = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chars, quote), _mm256_cmpeq_epi8(chars, backslash)),
+                    _mm256_cmpeq_epi8(chars, newLine));
+                unsigned mask = _mm256_movemask_epi8(found);
+                if (mask != 0)
+                    return begin + CountTrailingZero(mask);
+            }
+            return FindStringEndSSE2(begin, end);
+        }
+
+        MINIMOE_TARGET_AVX2
+        const char * SkipBlanksAVX2(const char * begin, const char * end)
+        {
+            const __m256i space = _mm256_set1_epi8(' ');
+            const __m256i tab = _mm256_set1_epi8('\t');
+            for (; end - begin >= 32; begin += 32)
+            {
+                __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(chars, space), _mm256_cmpeq_epi8(chars, tab));
+                unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(blank));
+                if (mask != 0)
+                    return begin + CountTrailingZero(mask);
+            }
+            return SkipBlanksSSE2(begin, end);
+        }
+
+        bool CpuSupportsAVX2()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx)
+                return false;
+            // the os should save the ymm registers
+            if ((_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+#endif
+    }
+
+    SimdLevel DetectSimdLevel()
+    {
+#ifdef MINIMOE_SIMD_X64
+        static const SimdLevel level = CpuSupportsAVX2() ? SimdLevel::AVX2 : SimdLevel::SSE2;
+        return level;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    const CharScanner & GetCharScanner()
+    {
+        static const CharScanner & scanner = GetCharScanner(DetectSimdLevel());
+        return scanner;
+    }
+
+    const CharScanner & GetCharScanner(SimdLevel level)
+    {
+        static const CharScanner scalar = { FindLineEndScalar, FindStringEndScalar, SkipBlanksScalar };
+#ifdef MINIMOE_SIMD_X64
+        static const CharScanner sse2 = { FindLineEndSSE2, FindStringEndSSE2, SkipBlanksSSE2 };
+        static const CharScanner avx2 = { FindLineEndAVX2, FindStringEndAVX2, SkipBlanksAVX2 };
+        DEBUGCHECK(level <= DetectSimdLevel());
+        switch (level)
+        {
+        case SimdLevel::AVX2:
+            return avx2;
+        case SimdLevel::SSE2:
+            return sse2;
+        default:
+            break;
+        }
+#endif
+        return scalar;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef MINIMOE_CHAR_SCANNER_H
+#define MINIMOE_CHAR_SCANNER_H
+
+namespace minimoe
+{
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE2,   // 16 bytes a time
+        AVX2,   // 32 bytes a time
+    };
+
+    // the best level supported by both the compiler and the cpu running the program
+    SimdLevel DetectSimdLevel();
+
+    // used by the lexer to skip the chars which don't end the current token,
+    // every function returns the first char in [begin, end) it's looking for, or end if not found
+    struct CharScanner
+    {
+        const char * (*FindLineEnd)(const char * begin, const char * end);     // '\n'
+        const char * (*FindStringEnd)(const char * begin, const char * end);   // '"', '\\' or '\n'
+        const char * (*SkipBlanks)(const char * begin, const char * end);      // not ' ' or '\t'
+    };
+
+    // scanner for DetectSimdLevel()
+    const CharScanner & GetCharScanner();
+    // level should not be higher than DetectSimdLevel()
+    const CharScanner & GetCharScanner(SimdLevel level);
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "Compiler/Lexer/CodeLineStream.h"
+#include "Compiler/Lexer/LexerEngine.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    using std::string;
+
+    CodeLineStream::CodeLineStream(Reader _reader, size_t _bufferSize, LexerEngine _engine)
+        : reader(std::move(_reader))
+        , bufferSize(_bufferSize == 0 ? 1 : _bufferSize)
+        , engine(_engine)
+        , endOfInput(false)
+        , nextRow(1)
+    {}
+
+    CodeLineStream::CodeLineStream(std::istream & input, size_t _bufferSize, LexerEngine _engine)
+        : CodeLineStream([&input](char * buffer, size_t size){
+                input.read(buffer, size);
+                return static_cast<size_t>(input.gcount());
+            }, _bufferSize, _engine)
+    {}
+
+    bool CodeLineStream::Next(CodeLine & line)
+    {
+        while (!chunk || nextLine == chunk->lines.end())
+        {
+            if (!LexNextChunk())
+                return false;
+        }
+        line = *nextLine;
+        ++nextLine;
+        return true;
+    }
+
+    bool CodeLineStream::LexNextChunk()
+    {
+        if (endOfInput && unfinishedLine.empty())
+            return false;
+
+        // read until a '\n' comes, the chunk ends just after the last one
+        string code = std::move(unfinishedLine);
+        unfinishedLine.clear();
+        while (!endOfInput)
+        {
+            size_t oldSize = code.size();
+            code.resize(oldSize + bufferSize);
+            size_t readSize = reader(&code[oldSize], bufferSize);
+            DEBUGCHECK(readSize <= bufferSize);
+            code.resize(oldSize + readSize);
+            if (readSize == 0)
+            {
+                endOfInput = true;
+                break;
+            }
+            // no '\n' before oldSize, or it would have ended the last chunk, so only the chars just read are searched
+            auto readBegin = code.rbegin() + readSize;
+            auto lastNewLine = std::find(code.rbegin(), readBegin, '\n');
+            if (lastNewLine != readBegin)
+            {
+                size_t chunkSize = code.rend() - lastNewLine;
+                unfinishedLine.assign(code, chunkSize, string::npos);
+                code.resize(chunkSize);
+                break;
+            }
+        }
+
+        chunk = std::make_shared<CodeFile>();
+        chunk->source = std::move(code);
+        const char * const codeBegin = chunk->source.data();
+        const char * const codeEnd = codeBegin + chunk->source.size();
+        chunk->sourceBase = SourceManager::Instance().AddSource(codeBegin, codeEnd - codeBegin, nextRow);
+        CodeFileBuilder builder(*chunk, codeBegin, chunk->sourceBase);
+        Lex(codeBegin, codeEnd, engine, builder);
+        builder.Finish();
+        nextRow += CountLines(codeBegin, codeEnd);
+        nextLine = chunk->lines.begin();
+
+        if (!chunk->errors.empty())
+        {
+            errors.insert(errors.end(), chunk->errors.begin(), chunk->errors.end());
+            errorChunks.push_back(chunk);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef MINIMOE_CODE_LINE_STREAM_H
+#define MINIMOE_CODE_LINE_STREAM_H
+
+#include <string>
+#include <functional>
+#include <istream>
+
+#include "Compiler/Lexer/Lexer.h"
+
+namespace minimoe
+{
+    // lexes code read piece by piece, every line can be taken as soon as it's complete.
+    // the code is lexed a chunk of complete lines at a time, so only the current chunk
+    // and the unfinished line after it are kept in memory, besides the chunks still used by the caller
+    class CodeLineStream
+    {
+    public:
+        // fill buffer with at most size chars and return the count of them, return 0 at the end of input
+        typedef std::function<size_t(char * buffer, size_t size)> Reader;
+
+        CodeLineStream(Reader _reader, size_t _bufferSize = 1 << 16,
+            LexerEngine _engine = LexerEngine::StateMachine);
+        CodeLineStream(std::istream & input, size_t _bufferSize = 1 << 16,
+            LexerEngine _engine = LexerEngine::StateMachine);
+        CodeLineStream(const CodeLineStream &) = delete;
+        CodeLineStream & operator=(const CodeLineStream &) = delete;
+
+        // return false if there is no more line,
+        // line refers to the tokens of CurrentChunk() and is valid as long as the chunk is alive
+        bool Next(CodeLine & line);
+        // the CodeFile owning the line returned by the last Next
+        CodeFile::Ptr CurrentChunk() const { return chunk; }
+
+        // lexer errors of all the lines returned so far,
+        // the chunks with errors are kept alive for them
+        CompileError::List errors;
+
+    private:
+        bool LexNextChunk();
+
+        Reader reader;
+        size_t bufferSize;
+        LexerEngine engine;
+        bool endOfInput;
+        size_t nextRow;
+        std::string unfinishedLine;
+        CodeFile::Ptr chunk;
+        LineIter nextLine;
+        CodeFile::List errorChunks;
+    };
+}
+
+#endif
@@ -1,63 +1,313 @@
-#include <sstream>
+#include <algorithm>
+#include <cstring>
 
 #include "Compiler/Lexer/Lexer.h"
+#include "Compiler/Lexer/LexerEngine.h"
+#include "Compiler/Lexer/CharScanner.h"
 #include "Utils/Debug.h"
+#include "Utils/ThreadPool.h"
 
 namespace minimoe
 {
     using std::string;
 
+    // all the keywords, shared by ClassifyIdentifier and TokenTypeToString
+#define MINIMOE_KEYWORDS(KEYWORD) \
+    KEYWORD(Module, "module") \
+    KEYWORD(Using, "using") \
+    KEYWORD(Phrase, "phrase") \
+    KEYWORD(Sentence, "sentence") \
+    KEYWORD(Block, "block") \
+    KEYWORD(Type, "type") \
+    KEYWORD(Tag, "tag") \
+    KEYWORD(CPS, "cps") \
+    KEYWORD(Category, "category") \
+    KEYWORD(Deferred, "deferred") \
+    KEYWORD(BlockBody, "blockbody") \
+    KEYWORD(Assignable, "assignable") \
+    KEYWORD(List, "list") \
+    KEYWORD(Var, "var") \
+    KEYWORD(End, "end") \
+    KEYWORD(And, "and") \
+    KEYWORD(Or, "or") \
+    KEYWORD(Not, "not")
+
+    // length and first char are enough to tell keywords apart,
+    // a collision will be reported at compile time as a duplicated case label
+    constexpr unsigned KeywordHash(size_t length, char first)
+    {
+        return static_cast<unsigned>(length) << 8 | static_cast<unsigned char>(first);
+    }
+
+    template<size_t N>
+    constexpr unsigned KeywordHash(const char (&text)[N])
+    {
+        return KeywordHash(N - 1, text[0]);
+    }
+
+    CodeTokenType ClassifyIdentifier(StringView value)
+    {
+        if (value.empty())
+            return CodeTokenType::Identifier;
+        switch (KeywordHash(value.size(), value[0]))
+        {
+#define KEYWORD_CASE(TYPE, TEXT) \
+        case KeywordHash(TEXT): \
+            return std::memcmp(value.data(), TEXT, sizeof(TEXT) - 1) == 0 ? CodeTokenType::TYPE : CodeTokenType::Identifier;
+        MINIMOE_KEYWORDS(KEYWORD_CASE)
+#undef KEYWORD_CASE
+        default:
+            return CodeTokenType::Identifier;
+        }
+    }
+
     std::string TokenTypeToString(CodeTokenType type)
     {
-        return
-            type == CodeTokenType::Add ? "+" :
-            type == CodeTokenType::And ? "and" :
-            type == CodeTokenType::BlockBody ? "blockbody" :
-            type == CodeTokenType::Assign ? "=" :
-            type == CodeTokenType::Assignable ? "assignable" :
-            type == CodeTokenType::Block ? "block" :
-            type == CodeTokenType::Category ? "category" :
-            type == CodeTokenType::CloseBracket ? ")" :
-            type == CodeTokenType::CloseSquareBracket ? "]" :
-            type == CodeTokenType::Colon ? ":" :
-            type == CodeTokenType::Comma ? "," :
-            type == CodeTokenType::CPS ? "cps" :
-            type == CodeTokenType::Deferred ? "deferred" :
-            type == CodeTokenType::Div ? "/" :
-            type == CodeTokenType::End ? "end" :
-            type == CodeTokenType::EQ ? "==" :
-            type == CodeTokenType::FloatLiteral ? "Float" :
-            type == CodeTokenType::GE ? ">=" :
-            type == CodeTokenType::GetMember ? "." :
-            type == CodeTokenType::GT ? ">" :
-            type == CodeTokenType::Identifier ? "identifier" :
-            type == CodeTokenType::IntegerLiteral ? "Integer" :
-            type == CodeTokenType::LE ? "<=" :
-            type == CodeTokenType::List ? "List" :
-            type == CodeTokenType::LT ? "<" :
-            type == CodeTokenType::Mod ? "%" :
-            type == CodeTokenType::Module ? "module" :
-            type == CodeTokenType::Mul ? "*" :
-            type == CodeTokenType::NE ? "<>" :
-            type == CodeTokenType::Not ? "not" :
-            type == CodeTokenType::OpenBracket ? "(" :
-            type == CodeTokenType::OpenSquareBracket ? "[" :
-            type == CodeTokenType::Or ? "or" :
-            type == CodeTokenType::Phrase ? "phrase" :
-            type == CodeTokenType::Sentence ? "sentence" :
-            type == CodeTokenType::StringLiteral ? "String" :
-            type == CodeTokenType::Sub ? "-" :
-            type == CodeTokenType::Tag ? "Tag" :
-            type == CodeTokenType::Type ? "Type" :
-            type == CodeTokenType::Using ? "using" :
-            type == CodeTokenType::Var ? "var" :
-            ERRORMSG("invalid CodeTokenType"), "UnKnown";
+        switch (type)
+        {
+#define KEYWORD_TO_STRING(TYPE, TEXT) \
+        case CodeTokenType::TYPE: return TEXT;
+        MINIMOE_KEYWORDS(KEYWORD_TO_STRING)
+#undef KEYWORD_TO_STRING
+        case CodeTokenType::IntegerLiteral: return "Integer";
+        case CodeTokenType::FloatLiteral: return "Float";
+        case CodeTokenType::StringLiteral: return "String";
+        case CodeTokenType::Identifier: return "identifier";
+        case CodeTokenType::OpenSquareBracket: return "[";
+        case CodeTokenType::CloseSquareBracket: return "]";
+        case CodeTokenType::OpenBracket: return "(";
+        case CodeTokenType::CloseBracket: return ")";
+        case CodeTokenType::Comma: return ",";
+        case CodeTokenType::Colon: return ":";
+        case CodeTokenType::Add: return "+";
+        case CodeTokenType::Sub: return "-";
+        case CodeTokenType::Mul: return "*";
+        case CodeTokenType::Div: return "/";
+        case CodeTokenType::Mod: return "%";
+        case CodeTokenType::LT: return "<";
+        case CodeTokenType::GT: return ">";
+        case CodeTokenType::LE: return "<=";
+        case CodeTokenType::GE: return ">=";
+        case CodeTokenType::EQ: return "==";
+        case CodeTokenType::NE: return "<>";
+        case CodeTokenType::Assign: return "=";
+        case CodeTokenType::GetMember: return ".";
+        default:
+            ERRORMSG("invalid CodeTokenType");
+            return "UnKnown";
+        }
+    }
+
+    /**************************
+    CodeFileBuilder
+    **************************/
+    CodeFileBuilder::CodeFileBuilder(CodeFile & _codeFile, const char * _codeBegin, SourceLocation _codeBase)
+        : codeFile(_codeFile)
+        , codeBegin(_codeBegin)
+        , codeBase(_codeBase)
+        , lineBreak(true)
+        , nameCache(NameCacheSize)
+    {}
+
+    void CodeFileBuilder::AddToken(StringView value, CodeTokenType type)
+    {
+        DEBUGCHECK(type != CodeTokenType::StringLiteral);
+        if (type == CodeTokenType::Identifier)
+            type = ClassifyIdentifier(value);
+        CodeToken token(LocationOf(value.data()), value, type);
+        if (type == CodeTokenType::Identifier)
+        {
+            auto & slot = nameCache[StringViewHash()(value) & (NameCacheSize - 1)];
+            if (slot.name.empty() || slot.text != value)
+                slot = { value, Name(value) };
+            token.name = slot.name;
+        }
+        PushToken(token);
+    }
+
+    void CodeFileBuilder::AddStringToken(StringView value, bool hasEscape)
+    {
+        // string literals without escape chars just refer to the source,
+        // the location is the open quote
+        CodeToken token(LocationOf(value.data() - 1), value, CodeTokenType::StringLiteral);
+        if (hasEscape)
+            codeFile.UnEscapeString(value, token);
+        // on invalid escape char, treat it as an valid string, but without escape, raise an error and go on.
+        PushToken(token);
+    }
+
+    void CodeFileBuilder::PushToken(const CodeToken & token)
+    {
+        if (lineBreak)
+        {
+            lineStarts.push_back(codeFile.tokens.size());
+            lineBreak = false;
+        }
+        codeFile.tokens.push_back(token);
+    }
+
+    void CodeFileBuilder::AddError(CompileErrorType errorType, StringView value)
+    {
+        CodeToken token(LocationOf(value.data()), value, CodeTokenType::UnKnown);
+        CompileError error = {
+            errorType, token
+        };
+        codeFile.errors.push_back(error);
+    }
+
+    void CodeFileBuilder::Append(CodeFileBuilder & chunk)
+    {
+        size_t tokenOffset = codeFile.tokens.size();
+        for (auto lineStart : chunk.lineStarts)
+            lineStarts.push_back(tokenOffset + lineStart);
+        auto & chunkFile = chunk.codeFile;
+        codeFile.tokens.insert(codeFile.tokens.end(),
+            std::make_move_iterator(chunkFile.tokens.begin()), std::make_move_iterator(chunkFile.tokens.end()));
+        codeFile.errors.insert(codeFile.errors.end(),
+            std::make_move_iterator(chunkFile.errors.begin()), std::make_move_iterator(chunkFile.errors.end()));
+        // splice keeps the unescaped strings where they are, so token values stay valid
+        codeFile.unescapedStrings.splice(codeFile.unescapedStrings.end(), chunkFile.unescapedStrings);
+        chunkFile.tokens.clear();
+        chunkFile.errors.clear();
+        chunk.lineStarts.clear();
+        lineBreak = true;
+    }
+
+    void CodeFileBuilder::Finish()
+    {
+        // tokens will not be reallocated any more, so it's safe to refer to them by iterator now
+        auto tokenBegin = codeFile.tokens.begin();
+        codeFile.lines.reserve(lineStarts.size());
+        for (size_t i = 0; i < lineStarts.size(); i++)
+        {
+            size_t lineEnd = i + 1 < lineStarts.size() ? lineStarts[i + 1] : codeFile.tokens.size();
+            CodeLine line = { tokenBegin + lineStarts[i], tokenBegin + lineEnd };
+            codeFile.lines.push_back(line);
+        }
+    }
+
+    void Lex(const char * codeBegin, const char * codeEnd, LexerEngine engine, CodeFileBuilder & builder)
+    {
+        switch (engine)
+        {
+        case LexerEngine::StateMachine:
+            LexByStateMachine(codeBegin, codeEnd, builder);
+            break;
+        case LexerEngine::TableDriven:
+            LexByTable(codeBegin, codeEnd, builder);
+            break;
+        }
+    }
+
+    size_t CountLines(const char * codeBegin, const char * codeEnd)
+    {
+        const CharScanner & scanner = GetCharScanner();
+        size_t count = 0;
+        for (auto it = scanner.FindLineEnd(codeBegin, codeEnd); it != codeEnd; it = scanner.FindLineEnd(it + 1, codeEnd))
+            count++;
+        return count;
+    }
+
+    /**************************
+    CodeFile
+    **************************/
+    CodeFile::~CodeFile()
+    {
+        if (sourceBase.IsValid())
+            SourceManager::Instance().RemoveSource(sourceBase);
+    }
+
+    CodeFile::Ptr CodeFile::Parse(const string & codeString, LexerEngine engine)
+    {
+        return Parse(string(codeString), engine);
     }
 
-    CodeFile::Ptr CodeFile::Parse(const string & codeString)
+    CodeFile::Ptr CodeFile::Parse(string && codeString, LexerEngine engine)
     {
         auto codeFile = std::make_shared<CodeFile>();
+        codeFile->source = std::move(codeString);
+        // tokens are views into codeFile->source
+        const char * const codeBegin = codeFile->source.data();
+        const char * const codeEnd = codeBegin + codeFile->source.size();
+        codeFile->sourceBase = SourceManager::Instance().AddSource(codeBegin, codeEnd - codeBegin);
 
+        CodeFileBuilder builder(*codeFile, codeBegin, codeFile->sourceBase);
+        Lex(codeBegin, codeEnd, engine, builder);
+        builder.Finish();
+        return codeFile;
+    }
+
+    CodeFile::Ptr CodeFile::Parse(MappedFile::Ptr file, LexerEngine engine)
+    {
+        auto codeFile = std::make_shared<CodeFile>();
+        codeFile->mappedSource = file;
+        const char * const codeBegin = file->data();
+        const char * const codeEnd = codeBegin + file->size();
+        codeFile->sourceBase = SourceManager::Instance().AddSource(codeBegin, codeEnd - codeBegin);
+
+        CodeFileBuilder builder(*codeFile, codeBegin, codeFile->sourceBase);
+        Lex(codeBegin, codeEnd, engine, builder);
+        builder.Finish();
+        return codeFile;
+    }
+
+    CodeFile::Ptr CodeFile::ParseParallel(string && codeString, ThreadPool & pool,
+        size_t chunkSize, LexerEngine engine)
+    {
+        auto codeFile = std::make_shared<CodeFile>();
+        codeFile->source = std::move(codeString);
+        const char * const codeBegin = codeFile->source.data();
+        const char * const codeEnd = codeBegin + codeFile->source.size();
+        codeFile->sourceBase = SourceManager::Instance().AddSource(codeBegin, codeEnd - codeBegin);
+        const CharScanner & scanner = GetCharScanner();
+
+        // every chunk but the last one ends just after a '\n', no token or error crosses chunks
+        std::vector<const char *> chunkBegins;
+        for (const char * chunkBegin = codeBegin; chunkBegin != codeEnd;)
+        {
+            chunkBegins.push_back(chunkBegin);
+            size_t rest = codeEnd - chunkBegin;
+            chunkBegin = scanner.FindLineEnd(chunkBegin + std::min(chunkSize, rest), codeEnd);
+            if (chunkBegin != codeEnd) ++chunkBegin;
+        }
+        chunkBegins.push_back(codeEnd);
+        size_t chunkCount = chunkBegins.size() - 1;
+
+        CodeFileBuilder builder(*codeFile, codeBegin, codeFile->sourceBase);
+        if (chunkCount <= 1)
+        {
+            Lex(codeBegin, codeEnd, engine, builder);
+            builder.Finish();
+            return codeFile;
+        }
+
+        // tokens of chunks still refer to codeFile->source and are located in it,
+        // only unescaped strings are owned by the chunks
+        std::vector<std::unique_ptr<CodeFile>> chunkFiles;
+        std::vector<CodeFileBuilder> chunkBuilders;
+        chunkFiles.reserve(chunkCount);
+        chunkBuilders.reserve(chunkCount);
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            chunkFiles.emplace_back(new CodeFile());
+            chunkBuilders.emplace_back(*chunkFiles.back(), codeBegin, codeFile->sourceBase);
+        }
+        pool.ParallelFor(chunkCount, [&](size_t i){
+            Lex(chunkBegins[i], chunkBegins[i + 1], engine, chunkBuilders[i]);
+        });
+
+        size_t tokenCount = 0;
+        for (size_t i = 0; i < chunkCount; i++)
+            tokenCount += chunkFiles[i]->tokens.size();
+        codeFile->tokens.reserve(tokenCount);
+        for (size_t i = 0; i < chunkCount; i++)
+            builder.Append(chunkBuilders[i]);
+        builder.Finish();
+        return codeFile;
+    }
+
+    void LexByStateMachine(const char * codeBegin, const char * codeEnd, CodeFileBuilder & builder)
+    {
         enum class State
         {
             Begin,
@@ -70,68 +320,16 @@ namespace minimoe
             InPreComment,
         };
 
-        size_t row = 1;
+        const CharScanner & scanner = GetCharScanner();
         State state = State::Begin;
-        auto charIt = std::begin(codeString);
-        auto rowBegin = std::begin(codeString);
-        const auto headUnusedTag = std::end(codeString);
-        auto head = headUnusedTag;
-
-        auto addToken = [&](const string value, CodeTokenType type){
-            auto tokenHead = head == headUnusedTag ? charIt : head;
-            auto token = std::make_shared<CodeToken>(
-                row, distance(rowBegin, tokenHead) + 1, value, type
-                );
-            if (type == CodeTokenType::Identifier)
-            {
-                token->type =
-                    value == "module" ? CodeTokenType::Module :
-                    value == "using" ? CodeTokenType::Using :
-                    value == "phrase" ? CodeTokenType::Phrase :
-                    value == "sentence" ? CodeTokenType::Sentence :
-                    value == "block" ? CodeTokenType::Block :
-                    value == "type" ? CodeTokenType::Type :
-                    value == "cps" ? CodeTokenType::CPS :
-                    value == "category" ? CodeTokenType::Category :
-                    value == "deferred" ? CodeTokenType::Deferred :
-                    value == "blockbody" ? CodeTokenType::BlockBody :
-                    value == "assignable" ? CodeTokenType::Assignable :
-                    value == "list" ? CodeTokenType::List :
-                    value == "end" ? CodeTokenType::End :
-                    value == "and" ? CodeTokenType::And :
-                    value == "or" ? CodeTokenType::Or :
-                    value == "not" ? CodeTokenType::Not :
-                    value == "tag" ? CodeTokenType::Tag :
-                    value == "var" ? CodeTokenType::Var :
-                    CodeTokenType::Identifier;
-            }
-            else if (type == CodeTokenType::StringLiteral)
-            {
-                bool success = codeFile->UnEscapeString(value, token);
-                if (!success)
-                {
-                } // treat it as an valid string, but without escape, raise an error and go on.
-            }
-
-            if (codeFile->lines.empty() || row > codeFile->lines.back()->tokens.back()->row)
-                codeFile->lines.push_back(std::make_shared<CodeLine>());
-            codeFile->lines.back()->tokens.push_back(token);
-        };
-
-        auto addError = [&](CompileErrorType errorType, const string value, const string errorMsg){
-            auto tokenHead = head == headUnusedTag ? charIt : head;
-            auto token = std::make_shared<CodeToken>(
-                row, distance(rowBegin, tokenHead) + 1, value, CodeTokenType::UnKnown
-                );
-            CompileError error = {
-                errorType, token, errorMsg
-            };
-            codeFile->errors.push_back(error);
-        };
+        const char * charIt = codeBegin;
+        const char * const headUnusedTag = codeEnd;
+        const char * head = headUnusedTag;
+        bool stringHasEscape = false;
 
         while (true)
         {
-            char c = charIt == std::end(codeString) ? '\0' : *charIt;
+            char c = charIt == codeEnd ? '\0' : *charIt;
             char nextChar = '\0';
             switch (state)
             {
@@ -139,88 +337,90 @@ namespace minimoe
                 switch (c)
                 {
                 case '[':
-                    addToken("[", CodeTokenType::OpenSquareBracket);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::OpenSquareBracket);
                     break;
                 case ']':
-                    addToken("]", CodeTokenType::CloseSquareBracket);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::CloseSquareBracket);
                     break;
                 case '(':
-                    addToken("(", CodeTokenType::OpenBracket);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::OpenBracket);
                     break;
                 case ')':
-                    addToken(")", CodeTokenType::CloseBracket);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::CloseBracket);
                     break;
                 case ',':
-                    addToken(",", CodeTokenType::Comma);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::Comma);
                     break;
                 case ':':
-                    addToken(":", CodeTokenType::Colon);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::Colon);
                     break;
                 case '+':
-                    addToken("+", CodeTokenType::Add);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::Add);
                     break;
                 case '-':
                     state = State::InPreComment;
                     break;
                 case '*':
-                    addToken("*", CodeTokenType::Mul);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::Mul);
                     break;
                 case '/':
-                    addToken("/", CodeTokenType::Div);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::Div);
                     break;
                 case '%':
-                    addToken("%", CodeTokenType::Mod);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::Mod);
                     break;
                 case '<':
-                    nextChar = std::next(charIt) != codeString.end() ?  *std::next(charIt) : '\0';
+                    nextChar = std::next(charIt) != codeEnd ?  *std::next(charIt) : '\0';
                     if (nextChar == '=')
                     {
-                        addToken("<=", CodeTokenType::LE);
+                        builder.AddToken(StringView(charIt, 2), CodeTokenType::LE);
                         ++charIt;
                     }
                     else if (nextChar == '>')
                     {
-                        addToken("<>", CodeTokenType::NE);
+                        builder.AddToken(StringView(charIt, 2), CodeTokenType::NE);
                         ++charIt;
                     }
                     else
-                        addToken("<", CodeTokenType::LT);
+                        builder.AddToken(StringView(charIt, 1), CodeTokenType::LT);
                     break;
                 case '>':
-                    nextChar = std::next(charIt) != codeString.end() ? *std::next(charIt) : '\0';
+                    nextChar = std::next(charIt) != codeEnd ? *std::next(charIt) : '\0';
                     if (nextChar == '=')
                     {
-                        addToken(">=", CodeTokenType::GE);
+                        builder.AddToken(StringView(charIt, 2), CodeTokenType::GE);
                         ++charIt;
                     }
                     else
-                        addToken(">", CodeTokenType::GT);
+                        builder.AddToken(StringView(charIt, 1), CodeTokenType::GT);
                     break;
                 case '=':
-                    nextChar = std::next(charIt) != codeString.end() ? *std::next(charIt) : '\0';
+                    nextChar = std::next(charIt) != codeEnd ? *std::next(charIt) : '\0';
                     if (nextChar == '=')
                     {
-                        addToken("==", CodeTokenType::EQ);
+                        builder.AddToken(StringView(charIt, 2), CodeTokenType::EQ);
                         ++charIt;
                     }
                     else
-                        addToken("=", CodeTokenType::Assign);
+                        builder.AddToken(StringView(charIt, 1), CodeTokenType::Assign);
                     break;
                 case '.':
-                    addToken(".", CodeTokenType::GetMember);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::GetMember);
                     break;
                 case '\n':
-                    row++;
-                    rowBegin = std::next(charIt);
+                    builder.NewLine();
                     break;
                 case '\0':
-                case '\t':
                 case '\r':
+                    break;
+                case '\t':
                 case ' ':
+                    charIt = scanner.SkipBlanks(charIt, codeEnd) - 1;
                     break;
                 case '"':
                     state = State::InString;
                     head = charIt;
+                    stringHasEscape = false;
                     break;
                 default:
                     if ('0' <= c && c <= '9')
@@ -235,7 +435,7 @@ namespace minimoe
                     }
                     else
                     {
-                        addError(CompileErrorType::Lexer_UnexpectedChar, string(1, c), "illegal char found: '" + string(1, c) + "'");
+                        builder.AddError(CompileErrorType::Lexer_UnexpectedChar, StringView(charIt, 1));
                         // ignore this char and go on from State::Begin
                     }
                     break;
@@ -247,7 +447,7 @@ namespace minimoe
                 else
                 {
                     --charIt;
-                    addToken("-", CodeTokenType::Sub);
+                    builder.AddToken(StringView(charIt, 1), CodeTokenType::Sub);
                     head = headUnusedTag;
                     state = State::Begin;
                 }
@@ -258,6 +458,11 @@ namespace minimoe
                     state = State::Begin;
                     --charIt;
                 }
+                else if (charIt != codeEnd)
+                {
+                    // stop just before the '\n'
+                    charIt = scanner.FindLineEnd(charIt, codeEnd) - 1;
+                }
                 break;
             case State::InIdentifier:
                 if ('a' <= c && c <= 'z' || 'A' <= c && c <= 'Z' || c == '_' || '0' <= c && c <= '9')
@@ -266,7 +471,7 @@ namespace minimoe
                 }
                 else
                 {
-                    addToken(string(head, charIt), CodeTokenType::Identifier);
+                    builder.AddToken(StringView(head, charIt - head), CodeTokenType::Identifier);
                     head = headUnusedTag;
                     state = State::Begin;
                     --charIt;
@@ -275,8 +480,7 @@ namespace minimoe
             case State::InString:
                 if (c == '\n')
                 {
-                    addError(CompileErrorType::Lexer_InCompleteString, string(head, charIt),
-                        "incomplete string, multiple line string is not allowed");
+                    builder.AddError(CompileErrorType::Lexer_InCompleteString, StringView(head, charIt - head));
                     head = headUnusedTag;
                     state = State::Begin;
                     --charIt; // let the next loop handle the row change
@@ -284,20 +488,24 @@ namespace minimoe
                 else if (c == '\\')
                 {
                     state = State::InStringEscaping;
+                    stringHasEscape = true;
                 }
                 else if (c == '"')
                 {
-                    addToken(string(std::next(head), charIt), CodeTokenType::StringLiteral);
+                    builder.AddStringToken(StringView(std::next(head), charIt - std::next(head)), stringHasEscape);
                     head = headUnusedTag;
                     state = State::Begin;
                 }
-                else {} // go on
+                else if (charIt != codeEnd)
+                {
+                    // go on until the char before the next '"', '\\' or '\n'
+                    charIt = scanner.FindStringEnd(charIt, codeEnd) - 1;
+                }
                 break;
             case State::InStringEscaping:
                 if (c == '\n')
                 {
-                    addError(CompileErrorType::Lexer_InCompleteString, string(head, charIt),
-                        "incomplete string, multiple line string is not allowed");
+                    builder.AddError(CompileErrorType::Lexer_InCompleteString, StringView(head, charIt - head));
                     head = headUnusedTag;
                     state = State::Begin;
                     --charIt; // let the next loop handle the row change
@@ -311,15 +519,14 @@ namespace minimoe
                 }
                 else if (c == '.')
                 {
-                    char nextChar = std::next(charIt) == codeString.end() ? '\0' : *std::next(charIt);
+                    char nextChar = std::next(charIt) == codeEnd ? '\0' : *std::next(charIt);
                     if ('0' <= nextChar && nextChar <= '9')
                         state = State::InFloat;
                     else
                     {
                         // ignore this '.' and treat this token as Float, but raise error
-                        addToken(string(head, charIt), CodeTokenType::FloatLiteral);
-                        addError(CompileErrorType::Lexer_InvalidFloat, string(head, std::next(charIt)),
-                            "'.' should be followed by digit");
+                        builder.AddToken(StringView(head, charIt - head), CodeTokenType::FloatLiteral);
+                        builder.AddError(CompileErrorType::Lexer_InvalidFloat, StringView(head, std::next(charIt) - head));
                         state = State::Begin;
                         head = headUnusedTag;
                     }
@@ -329,7 +536,7 @@ namespace minimoe
                     --charIt;
                     // decrease because the current char is not belong to this token
                     // and charIt will increase at the end of loop
-                    addToken(string(head, std::next(charIt)), CodeTokenType::IntegerLiteral);
+                    builder.AddToken(StringView(head, std::next(charIt) - head), CodeTokenType::IntegerLiteral);
                     state = State::Begin;
                     head = headUnusedTag;
                 }
@@ -344,70 +551,66 @@ namespace minimoe
                     --charIt;
                     // decrease because the current char is not belong to this token
                     // and charIt will increase at the end of loop
-                    addToken(string(head, std::next(charIt)), CodeTokenType::FloatLiteral);
+                    builder.AddToken(StringView(head, std::next(charIt) - head), CodeTokenType::FloatLiteral);
                     state = State::Begin;
                     head = headUnusedTag;
                 }
             } // end of switch
-            if (charIt == std::end(codeString)) break;
+            if (charIt == codeEnd) break;
             ++charIt;
         }
-
-        return codeFile;
     }
 
-    bool CodeFile::UnEscapeString(const string & s, CodeToken::Ptr & token)
+    bool CodeFile::UnEscapeString(StringView s, CodeToken & token)
     {
-        std::stringstream ss;
-        bool escaping = false;
-        for (size_t i = 0; i <= s.size(); i++)
+        // unescaped strings are packed into blocks, a block is never reallocated
+        // so that the tokens can refer to it, and an unescaped string is never longer than s
+        const size_t blockSize = 4096;
+        if (unescapedStrings.empty()
+            || unescapedStrings.back().capacity() - unescapedStrings.back().size() < s.size())
         {
-            char c = i == s.size() ? '\0' : s[i];
-            if (escaping)
+            unescapedStrings.emplace_back();
+            unescapedStrings.back().reserve(std::max(blockSize, s.size()));
+        }
+        string & block = unescapedStrings.back();
+        const size_t head = block.size();
+
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            char c = s[i];
+            if (c != '\\')
             {
-                if (c == 'a')
-                    ss << '\a';
-                else if (c == 'b')
-                    ss << '\b';
-                else if (c == 'f')
-                    ss << '\f';
-                else if (c == 'n')
-                    ss << '\n';
-                else if (c == 'r')
-                    ss << '\r';
-                else if (c == 't')
-                    ss << '\t';
-                else if (c == 'v')
-                    ss << '\v';
-                else if (c == '\\')
-                    ss << '\\';
-                else if (c == '\'')
-                    ss << '\'';
-                else if (c == '"')
-                    ss << '\"';
-                else if (c == '0')
-                    ss << '\0';
-                else
-                {
-                    CompileError error = {
-                        CompileErrorType::Lexer_InvalidEscapeChar,
-                        token,
-                        "invalid escape char found in string literal"
-                    };
-                    errors.push_back(error);
-                    return false;
-                }
-                escaping = false;
+                block.push_back(c);
+                continue;
             }
-            else
+            char escaped = ++i == s.size() ? '\0' : s[i];
+            switch (escaped)
+            {
+            case 'a': c = '\a'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'v': c = '\v'; break;
+            case '\\': c = '\\'; break;
+            case '\'': c = '\''; break;
+            case '"': c = '"'; break;
+            case '0': c = '\0'; break;
+            default:
             {
-                if (c == '\\')
-                    escaping = true;
-                else if (i != s.size())
-                    ss << c;
+                block.resize(head);
+                CompileError error = {
+                    CompileErrorType::Lexer_InvalidEscapeChar,
+                    token
+                };
+                errors.push_back(error);
+                return false;
+            }
             }
+            block.push_back(c);
         }
-        token->value = ss.str();
+        token.value = StringView(block.data() + head, block.size() - head);
         return true;
     }
 
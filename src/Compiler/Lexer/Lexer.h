@@ -4,8 +4,14 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <iterator>
+#include <list>
 
 #include "Compiler/CompileErrors.h"
+#include "Compiler/SourceLocation.h"
+#include "Compiler/Name.h"
+#include "Utils/StringView.h"
+#include "Utils/MappedFile.h"
 
 namespace minimoe
 {
@@ -61,53 +67,113 @@ namespace minimoe
     };
 
     std::string TokenTypeToString(CodeTokenType type);
+    // return the keyword type of value, or CodeTokenType::Identifier if it's not a keyword
+    CodeTokenType ClassifyIdentifier(StringView value);
 
+    // value refers to the text owned by the CodeFile which produced this token
     struct CodeToken
     {
-        typedef std::shared_ptr<CodeToken> Ptr;
-        typedef std::vector<Ptr> List;
+        typedef std::vector<CodeToken> List;
 
-        size_t row;
-        size_t column;
-        std::string value;
+        SourceLocation location;
         CodeTokenType type;
+        StringView value;
+        Name name; // interned value of identifiers, empty for the other tokens
 
-        CodeToken(size_t _row, size_t _column, std::string _value, CodeTokenType _type)
-            : row(_row), column(_column), value(_value), type(_type)
+        CodeToken()
+            : type(CodeTokenType::UnKnown)
+        {}
+        CodeToken(SourceLocation _location, StringView _value, CodeTokenType _type)
+            : location(_location), type(_type), value(_value)
         {}
+
+        // found by the SourceManager, 0 if the CodeFile of this token was destroyed
+        size_t Row() const { return SourceManager::Instance().Resolve(location).row; }
+        size_t Column() const { return SourceManager::Instance().Resolve(location).column; }
     };
 
     typedef CodeToken::List::iterator TokenIter;
 
+    // the message is only formatted when the error is reported, most of the errors raised
+    // by the speculative parsing are dropped before that
     struct CompileError
     {
         typedef std::vector<CompileError> List;
 
         CompileErrorType errorType;
-        CodeToken::Ptr token;
-        std::string errorMsg;
+        CodeToken token;
+        // the expected CodeTokenType for Parser_UnExpectedTokenType,
+        // the Name id of the expected fragment for Parser_WrongFunctionName, 0 for the others
+        uint32_t argument;
+
+        CompileError()
+            : errorType(CompileErrorType::Lexer_UnexpectedChar), argument(0)
+        {}
+        CompileError(CompileErrorType _errorType, const CodeToken & _token, uint32_t _argument = 0)
+            : errorType(_errorType), token(_token), argument(_argument)
+        {}
+
+        std::string Message() const;
     };
 
+    // a range of CodeFile::tokens, tokens are owned by the CodeFile
     struct CodeLine
     {
-        typedef std::shared_ptr<CodeLine> Ptr;
-        typedef std::vector<Ptr> List;
+        typedef std::vector<CodeLine> List;
 
-        CodeToken::List tokens;
+        TokenIter first;
+        TokenIter last;
+
+        TokenIter begin() const { return first; }
+        TokenIter end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+        CodeToken & front() const { return *first; }
+        CodeToken & back() const { return *std::prev(last); }
     };
 
     typedef CodeLine::List::iterator LineIter;
 
+    enum class LexerEngine
+    {
+        StateMachine,   // hand written state machine
+        TableDriven,    // character class table and state transition table
+    };
+
+    class ThreadPool;
+
     struct CodeFile
     {
         typedef std::shared_ptr<CodeFile> Ptr;
         typedef std::vector<Ptr> List;
 
+        // the code is in source, or in mappedSource if it's parsed from a MappedFile
+        std::string source;
+        MappedFile::Ptr mappedSource;
+        // location of the first char of the code, the code is added to the SourceManager while the CodeFile is alive
+        SourceLocation sourceBase;
+        // string literals containing escape chars, stored after unescaped,
+        // a list so that they never move when merged from other CodeFiles
+        std::list<std::string> unescapedStrings;
+        // all tokens of the file stored contiguously, lines refer to ranges of it
+        CodeToken::List tokens;
         CodeLine::List lines;
         CompileError::List errors;
 
-        static Ptr Parse(const std::string & codeString);
-        bool UnEscapeString(const std::string & s, CodeToken::Ptr & token);
+        CodeFile() {}
+        ~CodeFile();
+        CodeFile(const CodeFile &) = delete; // lines hold iterators into tokens
+        CodeFile & operator=(const CodeFile &) = delete;
+
+        static Ptr Parse(const std::string & codeString, LexerEngine engine = LexerEngine::StateMachine);
+        static Ptr Parse(std::string && codeString, LexerEngine engine = LexerEngine::StateMachine);
+        // lex the mapped file directly without copying it
+        static Ptr Parse(MappedFile::Ptr file, LexerEngine engine = LexerEngine::StateMachine);
+        // split the code into chunks of about chunkSize bytes at line boundaries and lex them on pool,
+        // the result is the same as Parse. it may be called from a task of pool
+        static Ptr ParseParallel(std::string && codeString, ThreadPool & pool,
+            size_t chunkSize = 1 << 18, LexerEngine engine = LexerEngine::StateMachine);
+        bool UnEscapeString(StringView s, CodeToken & token);
     };
 
 }
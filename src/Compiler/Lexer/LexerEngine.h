@@ -0,0 +1,62 @@
+#ifndef MINIMOE_LEXER_ENGINE_H
+#define MINIMOE_LEXER_ENGINE_H
+
+#include <string>
+#include <vector>
+
+#include "Compiler/Lexer/Lexer.h"
+
+namespace minimoe
+{
+    // appends tokens and errors to a CodeFile, shared by all the lexer engines.
+    // the locations of them are found by their positions in [codeBegin, codeEnd)
+    class CodeFileBuilder
+    {
+    public:
+        // codeBase is the location of codeBegin
+        CodeFileBuilder(CodeFile & _codeFile, const char * _codeBegin, SourceLocation _codeBase);
+
+        // for all the tokens except string literals
+        void AddToken(StringView value, CodeTokenType type);
+        // value is the string literal without quotes, hasEscape is whether it contains any backslash
+        void AddStringToken(StringView value, bool hasEscape);
+        void AddError(CompileErrorType errorType, StringView value);
+        // the tokens after it are in a new line
+        void NewLine() { lineBreak = true; }
+        // move everything built by chunk to the end of this one,
+        // chunk should be built from the lines right after the code of this builder
+        void Append(CodeFileBuilder & chunk);
+        // build CodeFile::lines, no more token should be added after that
+        void Finish();
+
+    private:
+        void PushToken(const CodeToken & token);
+        SourceLocation LocationOf(const char * position) const { return codeBase + (position - codeBegin); }
+
+        CodeFile & codeFile;
+        const char * codeBegin;
+        SourceLocation codeBase;
+        bool lineBreak;
+        // index of the first token of every line in codeFile.tokens
+        std::vector<size_t> lineStarts;
+        // direct mapped cache of the names interned by this builder,
+        // so that the same identifiers mostly don't go to the StringInterner again
+        struct NameCacheSlot
+        {
+            StringView text;
+            Name name;
+        };
+        static const size_t NameCacheSize = 1024;
+        std::vector<NameCacheSlot> nameCache;
+    };
+
+    // [codeBegin, codeEnd) should outlive the CodeFile of builder, and start at the beginning of a line
+    void LexByStateMachine(const char * codeBegin, const char * codeEnd, CodeFileBuilder & builder);
+    void LexByTable(const char * codeBegin, const char * codeEnd, CodeFileBuilder & builder);
+    void Lex(const char * codeBegin, const char * codeEnd, LexerEngine engine, CodeFileBuilder & builder);
+
+    // count of '\n' in [codeBegin, codeEnd)
+    size_t CountLines(const char * codeBegin, const char * codeEnd);
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include "Compiler/Lexer/LexerEngine.h"
+#include "Compiler/Lexer/CharScanner.h"
+
+namespace minimoe
+{
+    using std::string;
+
+    namespace
+    {
+        enum class CharClass : unsigned char
+        {
+            Letter,     // a-z A-Z _
+            Digit,      // 0-9
+            Dot,        // .
+            Quote,      // "
+            Backslash,  // backslash
+            Minus,      // -
+            Less,       // <
+            Greater,    // >
+            Equal,      // =
+            Operator,   // other operators with only one char
+            NewLine,    // \n
+            Blank,      // space \t \r \0
+            Illegal,
+            End,        // end of code, not in the char class table
+
+            Count,
+        };
+
+        enum class State : unsigned char
+        {
+            Begin,
+            Identifier,
+            Integer,
+            IntegerDot,     // integer followed by '.'
+            Float,
+            PreComment,     // '-'
+            Comment,
+            String,
+            StringEscaping,
+            EscapedString,  // string after an escape char
+            Less,           // '<'
+            Greater,        // '>'
+            Equal,          // '='
+
+            Count,
+        };
+
+        enum class Action : unsigned char
+        {
+            None,
+            MarkHead,           // current char is the head of a token
+            NewLine,
+            EmitChar,           // current char is an operator
+            EmitToHead,         // [head, current) is a token
+            EmitToCurrent,      // [head, current] is a token
+            EmitString,         // [head, current] is a string literal with quotes
+            EmitEscapedString,  // the same as EmitString, but the string contains escape chars
+            EmitInvalidFloat,   // [head, current) is an integer followed by '.' without digit
+            UnexpectedChar,
+            InCompleteString,
+        };
+
+        struct Transition
+        {
+            State next;
+            Action action;
+            CodeTokenType tokenType;    // for EmitToHead and EmitToCurrent
+            bool consume;               // or process the current char again in the next state
+        };
+
+        struct LexerTables
+        {
+            CharClass charClasses[256];
+            CodeTokenType operatorTypes[256];   // for CharClass::Operator and CharClass::Dot
+            Transition transitions[static_cast<int>(State::Count)][static_cast<int>(CharClass::Count)];
+            // whether a char only moves a state to itself, used to skip runs of such chars
+            bool stays[static_cast<int>(State::Count)][256];
+        };
+
+        LexerTables BuildLexerTables()
+        {
+            LexerTables tables;
+
+            for (int c = 0; c < 256; c++)
+            {
+                tables.charClasses[c] = CharClass::Illegal;
+                tables.operatorTypes[c] = CodeTokenType::UnKnown;
+            }
+            for (int c = 'a'; c <= 'z'; c++)
+                tables.charClasses[c] = CharClass::Letter;
+            for (int c = 'A'; c <= 'Z'; c++)
+                tables.charClasses[c] = CharClass::Letter;
+            tables.charClasses['_'] = CharClass::Letter;
+            for (int c = '0'; c <= '9'; c++)
+                tables.charClasses[c] = CharClass::Digit;
+            tables.charClasses['.'] = CharClass::Dot;
+            tables.charClasses['"'] = CharClass::Quote;
+            tables.charClasses['\\'] = CharClass::Backslash;
+            tables.charClasses['-'] = CharClass::Minus;
+            tables.charClasses['<'] = CharClass::Less;
+            tables.charClasses['>'] = CharClass::Greater;
+            tables.charClasses['='] = CharClass::Equal;
+            tables.charClasses['\n'] = CharClass::NewLine;
+            tables.charClasses[' '] = CharClass::Blank;
+            tables.charClasses['\t'] = CharClass::Blank;
+            tables.charClasses['\r'] = CharClass::Blank;
+            tables.charClasses['\0'] = CharClass::Blank;
+
+            auto setOperator = [&](char c, CodeTokenType type){
+                if (tables.charClasses[static_cast<unsigned char>(c)] == CharClass::Illegal)
+                    tables.charClasses[static_cast<unsigned char>(c)] = CharClass::Operator;
+                tables.operatorTypes[static_cast<unsigned char>(c)] = type;
+            };
+            setOperator('[', CodeTokenType::OpenSquareBracket);
+            setOperator(']', CodeTokenType::CloseSquareBracket);
+            setOperator('(', CodeTokenType::OpenBracket);
+            setOperator(')', CodeTokenType::CloseBracket);
+            setOperator(',', CodeTokenType::Comma);
+            setOperator(':', CodeTokenType::Colon);
+            setOperator('+', CodeTokenType::Add);
+            setOperator('*', CodeTokenType::Mul);
+            setOperator('/', CodeTokenType::Div);
+            setOperator('%', CodeTokenType::Mod);
+            setOperator('.', CodeTokenType::GetMember);
+
+            auto set = [&](State state, CharClass charClass, State next, Action action,
+                CodeTokenType tokenType, bool consume){
+                Transition transition = { next, action, tokenType, consume };
+                tables.transitions[static_cast<int>(state)][static_cast<int>(charClass)] = transition;
+            };
+            auto setAll = [&](State state, State next, Action action, CodeTokenType tokenType, bool consume){
+                for (int i = 0; i < static_cast<int>(CharClass::Count); i++)
+                    set(state, static_cast<CharClass>(i), next, action, tokenType, consume);
+            };
+            const auto none = CodeTokenType::UnKnown;
+
+            setAll(State::Begin, State::Begin, Action::UnexpectedChar, none, true);
+            set(State::Begin, CharClass::Letter, State::Identifier, Action::MarkHead, none, true);
+            set(State::Begin, CharClass::Digit, State::Integer, Action::MarkHead, none, true);
+            set(State::Begin, CharClass::Dot, State::Begin, Action::EmitChar, none, true);
+            set(State::Begin, CharClass::Quote, State::String, Action::MarkHead, none, true);
+            set(State::Begin, CharClass::Minus, State::PreComment, Action::MarkHead, none, true);
+            set(State::Begin, CharClass::Less, State::Less, Action::MarkHead, none, true);
+            set(State::Begin, CharClass::Greater, State::Greater, Action::MarkHead, none, true);
+            set(State::Begin, CharClass::Equal, State::Equal, Action::MarkHead, none, true);
+            set(State::Begin, CharClass::Operator, State::Begin, Action::EmitChar, none, true);
+            set(State::Begin, CharClass::NewLine, State::Begin, Action::NewLine, none, true);
+            set(State::Begin, CharClass::Blank, State::Begin, Action::None, none, true);
+            set(State::Begin, CharClass::End, State::Begin, Action::None, none, true);
+
+            setAll(State::Identifier, State::Begin, Action::EmitToHead, CodeTokenType::Identifier, false);
+            set(State::Identifier, CharClass::Letter, State::Identifier, Action::None, none, true);
+            set(State::Identifier, CharClass::Digit, State::Identifier, Action::None, none, true);
+
+            setAll(State::Integer, State::Begin, Action::EmitToHead, CodeTokenType::IntegerLiteral, false);
+            set(State::Integer, CharClass::Digit, State::Integer, Action::None, none, true);
+            set(State::Integer, CharClass::Dot, State::IntegerDot, Action::None, none, true);
+
+            setAll(State::IntegerDot, State::Begin, Action::EmitInvalidFloat, none, false);
+            set(State::IntegerDot, CharClass::Digit, State::Float, Action::None, none, true);
+
+            setAll(State::Float, State::Begin, Action::EmitToHead, CodeTokenType::FloatLiteral, false);
+            set(State::Float, CharClass::Digit, State::Float, Action::None, none, true);
+
+            setAll(State::PreComment, State::Begin, Action::EmitToHead, CodeTokenType::Sub, false);
+            set(State::PreComment, CharClass::Minus, State::Comment, Action::None, none, true);
+
+            setAll(State::Comment, State::Comment, Action::None, none, true);
+            set(State::Comment, CharClass::NewLine, State::Begin, Action::None, none, false);
+            set(State::Comment, CharClass::End, State::Begin, Action::None, none, false);
+
+            // a string without the close quote at the end of code is dropped
+            setAll(State::String, State::String, Action::None, none, true);
+            set(State::String, CharClass::Quote, State::Begin, Action::EmitString, none, true);
+            set(State::String, CharClass::Backslash, State::StringEscaping, Action::None, none, true);
+            set(State::String, CharClass::NewLine, State::Begin, Action::InCompleteString, none, false);
+            set(State::String, CharClass::End, State::Begin, Action::None, none, false);
+
+            setAll(State::EscapedString, State::EscapedString, Action::None, none, true);
+            set(State::EscapedString, CharClass::Quote, State::Begin, Action::EmitEscapedString, none, true);
+            set(State::EscapedString, CharClass::Backslash, State::StringEscaping, Action::None, none, true);
+            set(State::EscapedString, CharClass::NewLine, State::Begin, Action::InCompleteString, none, false);
+            set(State::EscapedString, CharClass::End, State::Begin, Action::None, none, false);
+
+            // escape chars are checked by CodeFile::UnEscapeString
+            setAll(State::StringEscaping, State::EscapedString, Action::None, none, true);
+            set(State::StringEscaping, CharClass::NewLine, State::Begin, Action::InCompleteString, none, false);
+            set(State::StringEscaping, CharClass::End, State::Begin, Action::None, none, false);
+
+            setAll(State::Less, State::Begin, Action::EmitToHead, CodeTokenType::LT, false);
+            set(State::Less, CharClass::Equal, State::Begin, Action::EmitToCurrent, CodeTokenType::LE, true);
+            set(State::Less, CharClass::Greater, State::Begin, Action::EmitToCurrent, CodeTokenType::NE, true);
+
+            setAll(State::Greater, State::Begin, Action::EmitToHead, CodeTokenType::GT, false);
+            set(State::Greater, CharClass::Equal, State::Begin, Action::EmitToCurrent, CodeTokenType::GE, true);
+
+            setAll(State::Equal, State::Begin, Action::EmitToHead, CodeTokenType::Assign, false);
+            set(State::Equal, CharClass::Equal, State::Begin, Action::EmitToCurrent, CodeTokenType::EQ, true);
+
+            for (int state = 0; state < static_cast<int>(State::Count); state++)
+            {
+                for (int c = 0; c < 256; c++)
+                {
+                    auto & transition = tables.transitions[state][static_cast<int>(tables.charClasses[c])];
+                    tables.stays[state][c] = transition.action == Action::None
+                        && transition.consume
+                        && static_cast<int>(transition.next) == state;
+                }
+            }
+
+            return tables;
+        }
+    }
+
+    void LexByTable(const char * codeBegin, const char * codeEnd, CodeFileBuilder & builder)
+    {
+        static const LexerTables tables = BuildLexerTables();
+        const CharScanner & scanner = GetCharScanner();
+
+        State state = State::Begin;
+        const char * charIt = codeBegin;
+        const char * head = codeBegin;
+
+        while (true)
+        {
+            CharClass charClass = charIt == codeEnd
+                ? CharClass::End
+                : tables.charClasses[static_cast<unsigned char>(*charIt)];
+            const Transition & transition =
+                tables.transitions[static_cast<int>(state)][static_cast<int>(charClass)];
+
+            // most of chars just move to the next state, don't go through the switch
+            if (transition.action == Action::None)
+            {
+                if (transition.consume)
+                {
+                    if (charIt == codeEnd) break;
+                    ++charIt;
+                    if (transition.next == state)
+                    {
+                        // chars of identifiers, numbers, comments and strings, stay in this state
+                        if (state == State::Comment)
+                            charIt = scanner.FindLineEnd(charIt, codeEnd);
+                        else if (state == State::String || state == State::EscapedString)
+                            charIt = scanner.FindStringEnd(charIt, codeEnd);
+                        else if (state == State::Begin)
+                            charIt = scanner.SkipBlanks(charIt, codeEnd);
+                        auto & stays = tables.stays[static_cast<int>(state)];
+                        while (charIt != codeEnd && stays[static_cast<unsigned char>(*charIt)])
+                            ++charIt;
+                    }
+                }
+                state = transition.next;
+                continue;
+            }
+
+            switch (transition.action)
+            {
+            case Action::None:
+                break;
+            case Action::MarkHead:
+                head = charIt;
+                break;
+            case Action::NewLine:
+                builder.NewLine();
+                break;
+            case Action::EmitChar:
+                builder.AddToken(StringView(charIt, 1), tables.operatorTypes[static_cast<unsigned char>(*charIt)]);
+                break;
+            case Action::EmitToHead:
+                builder.AddToken(StringView(head, charIt - head), transition.tokenType);
+                break;
+            case Action::EmitToCurrent:
+                builder.AddToken(StringView(head, charIt + 1 - head), transition.tokenType);
+                break;
+            case Action::EmitString:
+            case Action::EmitEscapedString:
+                builder.AddStringToken(StringView(head + 1, charIt - head - 1),
+                    transition.action == Action::EmitEscapedString);
+                break;
+            case Action::EmitInvalidFloat:
+                // ignore the '.' and treat this token as Float, but raise error
+                builder.AddToken(StringView(head, charIt - 1 - head), CodeTokenType::FloatLiteral);
+                builder.AddError(CompileErrorType::Lexer_InvalidFloat, StringView(head, charIt - head));
+                break;
+            case Action::UnexpectedChar:
+                builder.AddError(CompileErrorType::Lexer_UnexpectedChar, StringView(charIt, 1));
+                break;
+            case Action::InCompleteString:
+                builder.AddError(CompileErrorType::Lexer_InCompleteString, StringView(head, charIt - head));
+                break;
+            }
+
+            state = transition.next;
+            if (transition.consume)
+            {
+                if (charIt == codeEnd) break;
+                ++charIt;
+            }
+        }
+    }
+}
@@ -0,0 +1,359 @@
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <unordered_map>
+
+#include "ModuleInterface.h"
+#include "Utils/MappedFile.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    using std::string;
+
+    uint64_t HashBytes(const char * data, size_t size)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /*******************
+    Format
+    ********************/
+    // little endian whatever the machine is:
+    //     "MOEI", version, sourceHash, declarationHash, size of the declarations, declarations, usingHashes
+    // the declarations:
+    //     names, module name, usings, tags, types (name, members), functions (type, alias, fragments)
+    // names are written once in a table, then referred to by index, 0 is the empty name
+    namespace
+    {
+        const char Magic[4] = { 'M', 'O', 'E', 'I' };
+        const uint32_t Version = 1;
+
+        class InterfaceWriter
+        {
+        public:
+            string bytes;
+
+            void WriteUInt8(uint8_t value)
+            {
+                bytes.push_back(static_cast<char>(value));
+            }
+
+            void WriteUInt32(uint32_t value)
+            {
+                for (size_t i = 0; i < 4; i++)
+                    WriteUInt8(static_cast<uint8_t>(value >> (i * 8)));
+            }
+
+            void WriteUInt64(uint64_t value)
+            {
+                for (size_t i = 0; i < 8; i++)
+                    WriteUInt8(static_cast<uint8_t>(value >> (i * 8)));
+            }
+
+            void WriteCount(size_t count)
+            {
+                WriteUInt32(static_cast<uint32_t>(count));
+            }
+
+            void WriteName(Name name)
+            {
+                if (name.empty())
+                {
+                    WriteUInt32(0);
+                    return;
+                }
+                auto found = nameIndexes.insert({ name, static_cast<uint32_t>(names.size() + 1) });
+                if (found.second)
+                    names.push_back(name);
+                WriteUInt32(found.first->second);
+            }
+
+            // the table of the names written, and then the bytes
+            string Finish()
+            {
+                InterfaceWriter table;
+                table.WriteCount(names.size());
+                for (auto & name : names)
+                {
+                    auto text = name.View();
+                    table.WriteCount(text.size());
+                    table.bytes.append(text.data(), text.size());
+                }
+                return table.bytes + bytes;
+            }
+
+        private:
+            std::unordered_map<Name, uint32_t, NameHash> nameIndexes;
+            std::vector<Name> names;
+        };
+
+        // any read out of the bytes or any invalid value fails the whole reading, then everything read is 0
+        class InterfaceReader
+        {
+        public:
+            InterfaceReader(const char * _data, size_t _size)
+                : data(_data), size(_size)
+            {}
+
+            bool Failed() const { return failed; }
+            bool Finished() const { return position == size; }
+
+            uint8_t ReadUInt8()
+            {
+                if (failed || position + 1 > size)
+                    return failed = true, 0;
+                return static_cast<uint8_t>(data[position++]);
+            }
+
+            uint32_t ReadUInt32()
+            {
+                uint32_t value = 0;
+                for (size_t i = 0; i < 4; i++)
+                    value |= static_cast<uint32_t>(ReadUInt8()) << (i * 8);
+                return failed ? 0 : value;
+            }
+
+            uint64_t ReadUInt64()
+            {
+                uint64_t value = 0;
+                for (size_t i = 0; i < 8; i++)
+                    value |= static_cast<uint64_t>(ReadUInt8()) << (i * 8);
+                return failed ? 0 : value;
+            }
+
+            // every counted item takes at least one byte, so a broken count never allocates much
+            size_t ReadCount()
+            {
+                size_t count = ReadUInt32();
+                if (count > size - position)
+                    return failed = true, 0;
+                return count;
+            }
+
+            StringView ReadBytes(size_t count)
+            {
+                if (failed || count > size - position)
+                    return failed = true, StringView();
+                StringView bytes(data + position, count);
+                position += count;
+                return bytes;
+            }
+
+            void ReadNames()
+            {
+                size_t count = ReadCount();
+                names.assign(1, Name());
+                for (size_t i = 0; i < count && !failed; i++)
+                    names.push_back(Name(ReadBytes(ReadCount())));
+            }
+
+            Name ReadName()
+            {
+                uint32_t index = ReadUInt32();
+                if (index >= names.size())
+                    return failed = true, Name();
+                return names[index];
+            }
+
+            // an enum value no more than last
+            template<class Enum>
+            Enum ReadEnum(Enum last)
+            {
+                uint8_t value = ReadUInt8();
+                if (value > static_cast<uint8_t>(last))
+                    failed = true;
+                return static_cast<Enum>(value);
+            }
+
+        private:
+            const char * data;
+            size_t size;
+            size_t position = 0;
+            bool failed = false;
+            std::vector<Name> names;
+        };
+
+        string SerializeDeclarations(const Module & module)
+        {
+            InterfaceWriter writer;
+            writer.WriteName(module.name);
+            writer.WriteCount(module.usings.size());
+            for (auto & usi : module.usings)
+                writer.WriteName(static_cast<UsingDeclaration*>(usi.get())->moduleName);
+            writer.WriteCount(module.tags.size());
+            for (auto & tag : module.tags)
+                writer.WriteName(static_cast<TagDeclaration*>(tag.get())->name);
+            writer.WriteCount(module.types.size());
+            for (auto & declaration : module.types)
+            {
+                auto type = static_cast<TypeDeclaration*>(declaration.get());
+                writer.WriteName(type->name);
+                writer.WriteCount(type->members.size());
+                for (auto & member : type->members)
+                    writer.WriteName(member);
+            }
+            writer.WriteCount(module.functions.size());
+            for (auto & function : module.functions)
+            {
+                writer.WriteUInt8(static_cast<uint8_t>(function->type));
+                writer.WriteName(function->alias);
+                writer.WriteCount(function->fragments.size());
+                size_t argumentIndex = 0;
+                for (auto & fragment : function->fragments)
+                {
+                    writer.WriteUInt8(static_cast<uint8_t>(fragment->type));
+                    writer.WriteName(fragment->name);
+                    if (fragment->type == FunctionFragmentType::Argument)
+                        writer.WriteUInt8(static_cast<uint8_t>(function->arguments[argumentIndex++]->type));
+                }
+            }
+            return writer.Finish();
+        }
+
+        Module::Ptr DeserializeDeclarations(StringView declarations)
+        {
+            InterfaceReader reader(declarations.data(), declarations.size());
+            reader.ReadNames();
+            auto module = std::make_shared<Module>();
+            module->name = reader.ReadName();
+            for (size_t i = reader.ReadCount(); i > 0 && !reader.Failed(); i--)
+            {
+                auto usi = std::make_shared<UsingDeclaration>();
+                usi->moduleName = reader.ReadName();
+                module->usings.push_back(usi);
+            }
+            for (size_t i = reader.ReadCount(); i > 0 && !reader.Failed(); i--)
+            {
+                auto tag = std::make_shared<TagDeclaration>();
+                tag->name = reader.ReadName();
+                module->tags.push_back(tag);
+            }
+            for (size_t i = reader.ReadCount(); i > 0 && !reader.Failed(); i--)
+            {
+                auto type = std::make_shared<TypeDeclaration>();
+                type->name = reader.ReadName();
+                for (size_t j = reader.ReadCount(); j > 0 && !reader.Failed(); j--)
+                    type->members.push_back(reader.ReadName());
+                module->types.push_back(type);
+            }
+            for (size_t i = reader.ReadCount(); i > 0 && !reader.Failed(); i--)
+            {
+                auto function = FunctionDeclaration::Make(reader.ReadEnum(FunctionType::Block));
+                function->alias = reader.ReadName();
+                for (size_t j = reader.ReadCount(); j > 0 && !reader.Failed(); j--)
+                {
+                    auto fragment = std::make_shared<FunctionFragment>();
+                    fragment->type = reader.ReadEnum(FunctionFragmentType::Argument);
+                    fragment->name = reader.ReadName();
+                    if (fragment->type == FunctionFragmentType::Argument)
+                    {
+                        auto argument = std::make_shared<ArgumentDeclaration>();
+                        argument->type = reader.ReadEnum(FunctionArgumentType::Assignable);
+                        argument->name = fragment->name;
+                        function->arguments.push_back(argument);
+                    }
+                    function->fragments.push_back(fragment);
+                }
+                module->functions.push_back(function);
+            }
+            if (reader.Failed() || !reader.Finished())
+                return nullptr;
+            return module;
+        }
+    }
+
+    /*******************
+    ModuleInterface
+    ********************/
+    ModuleInterface::Ptr ModuleInterface::Make(const Module::Ptr & module, uint64_t sourceHash)
+    {
+        auto moduleInterface = std::make_shared<ModuleInterface>();
+        moduleInterface->sourceHash = sourceHash;
+        moduleInterface->declarations = SerializeDeclarations(*module);
+        moduleInterface->declarationHash = HashBytes(moduleInterface->declarations.data(), moduleInterface->declarations.size());
+        moduleInterface->module = module;
+        return moduleInterface;
+    }
+
+    string ModuleInterface::Serialize() const
+    {
+        InterfaceWriter writer;
+        writer.bytes.append(Magic, sizeof(Magic));
+        writer.WriteUInt32(Version);
+        writer.WriteUInt64(sourceHash);
+        writer.WriteUInt64(declarationHash);
+        writer.WriteUInt64(declarations.size());
+        writer.bytes += declarations;
+        writer.WriteCount(usingHashes.size());
+        for (auto hash : usingHashes)
+            writer.WriteUInt64(hash);
+        return writer.bytes;
+    }
+
+    ModuleInterface::Ptr ModuleInterface::Load(const char * data, size_t size)
+    {
+        InterfaceReader reader(data, size);
+        auto magic = reader.ReadBytes(sizeof(Magic));
+        if (reader.Failed() || std::memcmp(magic.data(), Magic, sizeof(Magic)) != 0 || reader.ReadUInt32() != Version)
+            return nullptr;
+
+        auto moduleInterface = std::make_shared<ModuleInterface>();
+        moduleInterface->sourceHash = reader.ReadUInt64();
+        moduleInterface->declarationHash = reader.ReadUInt64();
+        uint64_t declarationSize = reader.ReadUInt64();
+        if (declarationSize > size)
+            return nullptr;
+        auto declarations = reader.ReadBytes(static_cast<size_t>(declarationSize));
+        for (size_t i = reader.ReadCount(); i > 0 && !reader.Failed(); i--)
+            moduleInterface->usingHashes.push_back(reader.ReadUInt64());
+        if (reader.Failed() || !reader.Finished()
+            || HashBytes(declarations.data(), declarations.size()) != moduleInterface->declarationHash)
+            return nullptr;
+
+        moduleInterface->module = DeserializeDeclarations(declarations);
+        if (moduleInterface->module == nullptr)
+            return nullptr;
+        moduleInterface->declarations = declarations.ToString();
+        return moduleInterface;
+    }
+
+    ModuleInterface::Ptr ModuleInterface::Load(const string & path)
+    {
+        string errorMsg;
+        auto file = MappedFile::Open(path, errorMsg);
+        if (file == nullptr)
+            return nullptr;
+        return Load(file->data(), file->size());
+    }
+
+    bool ModuleInterface::Save(const string & path, string & errorMsg) const
+    {
+        string temporaryPath = path + ".tmp";
+        {
+            std::ofstream output(temporaryPath, std::ios::binary);
+            auto bytes = Serialize();
+            output.write(bytes.data(), bytes.size());
+            if (!output)
+            {
+                errorMsg = "can't write file: " + temporaryPath;
+                return false;
+            }
+        }
+        // rename doesn't replace an existing file on every platform
+        std::remove(path.c_str());
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            errorMsg = "can't write file: " + path;
+            return false;
+        }
+        return true;
+    }
+}
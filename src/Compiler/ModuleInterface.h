@@ -0,0 +1,47 @@
+#ifndef MINIMOE_MODULE_INTERFACE_H
+#define MINIMOE_MODULE_INTERFACE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "Compiler/Parser/DeclarationParser.h"
+
+namespace minimoe
+{
+    // FNV-1a
+    uint64_t HashBytes(const char * data, size_t size);
+
+    // what the modules using a module see of it: the usings, tags, type members, and the fragments
+    // and argument kinds of the functions, without the function bodies and the source locations.
+    // saved as a flat binary after the module is compiled, so that a later build maps it and gets the
+    // declarations in one pass, instead of lexing and parsing the unchanged source again
+    class ModuleInterface
+    {
+    public:
+        typedef std::shared_ptr<ModuleInterface> Ptr;
+
+        // of the source the module is parsed from
+        uint64_t sourceHash = 0;
+        // of the declarations, the modules using this one are compiled again only when it's changed
+        uint64_t declarationHash = 0;
+        // the declarationHash of the modules in module->usings when this one is compiled, in the same order
+        std::vector<uint64_t> usingHashes;
+        // the functions have no lines, startIter and endIter are not used
+        Module::Ptr module;
+
+        static Ptr Make(const Module::Ptr & module, uint64_t sourceHash);
+        // return nullptr if it's not an interface of this version
+        static Ptr Load(const char * data, size_t size);
+        static Ptr Load(const std::string & path);
+        std::string Serialize() const;
+        // written to another file and renamed, so a build never sees half of it
+        bool Save(const std::string & path, std::string & errorMsg) const;
+
+    private:
+        std::string declarations; // serialized module
+    };
+}
+
+#endif
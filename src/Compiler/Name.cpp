@@ -0,0 +1,58 @@
+#include "Compiler/Name.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    namespace
+    {
+        const size_t TextBlockSize = 4096;
+    }
+
+    StringInterner & StringInterner::Instance()
+    {
+        static StringInterner interner;
+        return interner;
+    }
+
+    // id is (index in the shard + 1) << ShardBits | shard
+    uint32_t StringInterner::Intern(StringView text)
+    {
+        if (text.empty())
+            return 0;
+        size_t hash = StringViewHash()(text);
+        uint32_t shardIndex = static_cast<uint32_t>(hash ^ (hash >> 16)) & (ShardCount - 1);
+        auto & shard = shards[shardIndex];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.ids.find(text);
+        if (it != shard.ids.end())
+            return it->second;
+
+        // texts are appended to a block without reallocating it, so the views stay valid
+        if (shard.blocks.empty() || shard.blocks.back().capacity() - shard.blocks.back().size() < text.size())
+        {
+            shard.blocks.emplace_back();
+            shard.blocks.back().reserve(text.size() > TextBlockSize ? text.size() : TextBlockSize);
+        }
+        auto & block = shard.blocks.back();
+        StringView copied(block.data() + block.size(), text.size());
+        block.append(text.begin(), text.end());
+
+        DEBUGCHECK_WITH_MSG(shard.texts.size() < (UINT32_MAX >> ShardBits) - 1, "interned ids are used up");
+        uint32_t id = (static_cast<uint32_t>(shard.texts.size() + 1) << ShardBits) | shardIndex;
+        shard.texts.push_back(copied);
+        shard.ids[copied] = id;
+        return id;
+    }
+
+    StringView StringInterner::Lookup(uint32_t id)
+    {
+        if (id == 0)
+            return StringView();
+        auto & shard = shards[id & (ShardCount - 1)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t index = (id >> ShardBits) - 1;
+        DEBUGCHECK(index < shard.texts.size());
+        return shard.texts[index];
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef MINIMOE_NAME_H
+#define MINIMOE_NAME_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "Utils/StringView.h"
+
+namespace minimoe
+{
+    // gives every distinct text a stable 32-bit id, shared by all the threads.
+    // the texts are copied and never released, id 0 is the empty text
+    class StringInterner
+    {
+    public:
+        static StringInterner & Instance();
+
+        uint32_t Intern(StringView text);
+        StringView Lookup(uint32_t id);
+
+    private:
+        // texts are spread over the shards by hash, so lexing on several threads rarely waits for each other
+        static const uint32_t ShardBits = 4;
+        static const uint32_t ShardCount = 1 << ShardBits;
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<StringView, uint32_t, StringViewHash> ids; // keys refer to blocks
+            std::vector<StringView> texts;
+            std::list<std::string> blocks;
+        };
+
+        StringInterner() = default;
+
+        Shard shards[ShardCount];
+    };
+
+    // an interned identifier, compared by id
+    class Name
+    {
+    public:
+        Name()
+            : id(0)
+        {}
+        Name(StringView text)
+            : id(StringInterner::Instance().Intern(text))
+        {}
+        Name(const std::string & text)
+            : Name(StringView(text))
+        {}
+        Name(const char * text)
+            : Name(StringView(text))
+        {}
+
+        uint32_t Id() const { return id; }
+        bool empty() const { return id == 0; }
+        StringView View() const { return StringInterner::Instance().Lookup(id); }
+        std::string ToString() const { return View().ToString(); }
+
+    private:
+        uint32_t id;
+    };
+
+    inline bool operator==(const Name & lhs, const Name & rhs) { return lhs.Id() == rhs.Id(); }
+    inline bool operator!=(const Name & lhs, const Name & rhs) { return lhs.Id() != rhs.Id(); }
+
+    struct NameHash
+    {
+        size_t operator()(const Name & name) const { return name.Id(); }
+    };
+}
+
+#endif
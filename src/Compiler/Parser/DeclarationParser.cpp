@@ -2,6 +2,7 @@
 
 #include "UtilsParser.h"
 #include "DeclarationParser.h"
+#include "Utils/ThreadPool.h"
 #include "Utils/Debug.h"
 
 namespace minimoe
@@ -11,39 +12,48 @@ namespace minimoe
     /***********************
     Parse
     **********************/
-    std::string ParseName(LineIter & head, LineIter tail, CodeTokenType HeadTokenType, CompileError::List & errors)
+    Name ParseName(LineIter & head, LineIter tail, CodeTokenType HeadTokenType, CompileError::List & errors)
     {
-        string name;
-        ParseLineFunc GetName = [&](TokenIter & tokenIt, TokenIter tokenEnd){
+        Name name;
+        auto GetName = [&](TokenIter & tokenIt, TokenIter tokenEnd){
             if (!CheckSingleTokenType(tokenIt, tokenEnd, HeadTokenType, errors))
                 return false;
             if (CheckReachTheEnd(tokenIt, tokenEnd, errors))
                 return false;
-            name = (*tokenIt)->value;
+            name = tokenIt->name;
             if (!CheckSingleTokenType(tokenIt, tokenEnd, CodeTokenType::Identifier, errors))
                 return false;
             return true;
         };
         auto helper = GenParseLineHelper(head, tail, errors);
         if (!helper(GetName))
-            return "";
+            return Name();
         return name;
     }
 
+    SourceLocation DeclarationLocation(LineIter head, LineIter tail)
+    {
+        return head == tail ? SourceLocation() : head->front().location;
+    }
+
     UsingDeclaration::Ptr UsingDeclaration::Parse(LineIter & head, LineIter tail, CompileError::List & errors)
     {
-        std::string name = ParseName(head, tail, CodeTokenType::Using, errors);
+        auto location = DeclarationLocation(head, tail);
+        Name name = ParseName(head, tail, CodeTokenType::Using, errors);
         if (name.empty()) return nullptr;
         auto usi = std::make_shared<UsingDeclaration>();
+        usi->location = location;
         usi->moduleName = name;
         return usi;
     }
 
     TagDeclaration::Ptr TagDeclaration::Parse(LineIter & head, LineIter tail, CompileError::List & errors)
     {
-        string name = ParseName(head, tail, CodeTokenType::Tag, errors);
+        auto location = DeclarationLocation(head, tail);
+        Name name = ParseName(head, tail, CodeTokenType::Tag, errors);
         if (name.empty()) return nullptr;
         auto tag = std::make_shared<TagDeclaration>();
+        tag->location = location;
         tag->name = name;
         return tag;
     }
@@ -51,13 +61,14 @@ namespace minimoe
     TypeDeclaration::Ptr TypeDeclaration::Parse(LineIter & head, LineIter tail, CompileError::List & errors)
     {
         auto type = std::make_shared<TypeDeclaration>();
+        type->location = DeclarationLocation(head, tail);
 
-        ParseLineFunc GetName = [&](TokenIter & tokenIt, TokenIter tokenEnd){
+        auto GetName = [&](TokenIter & tokenIt, TokenIter tokenEnd){
             if (!CheckSingleTokenType(tokenIt, tokenEnd, CodeTokenType::Type, errors))
                 return false;
             if (CheckReachTheEnd(tokenIt, tokenEnd, errors))
                 return false;
-            string name = (*tokenIt)->value;
+            Name name = tokenIt->name;
             if (!CheckSingleTokenType(tokenIt, tokenEnd, CodeTokenType::Identifier, errors))
                 return false;
             type->name = name;
@@ -65,14 +76,14 @@ namespace minimoe
         };
 
         bool ended = false;
-        ParseLineFunc GetMember = [&](TokenIter & tokenIt, TokenIter tokenEnd){
-            if ((*tokenIt)->type == CodeTokenType::End)
+        auto GetMember = [&](TokenIter & tokenIt, TokenIter tokenEnd){
+            if (tokenIt->type == CodeTokenType::End)
             {
                 ++tokenIt;
                 ended = true;
                 return true;
             }
-            string member = (*tokenIt)->value;
+            Name member = tokenIt->name;
             if (!CheckSingleTokenType(tokenIt, tokenEnd, CodeTokenType::Identifier, errors))
                 return false;
             type->members.push_back(member);
@@ -93,24 +104,25 @@ namespace minimoe
 
     ArgumentDeclaration::Ptr ArgumentDeclaration::Parse(TokenIter & head, TokenIter tail, CompileError::List & errors)
     {
+        auto openBracket = head;
         if (!CheckSingleTokenType(head, tail, CodeTokenType::OpenBracket, errors))
             return nullptr;
         auto arg = std::make_shared<ArgumentDeclaration>();
-        auto token = *head;
-        if (token->type != CodeTokenType::Identifier)
+        arg->location = openBracket->location;
+        auto & token = *head;
+        if (token.type != CodeTokenType::Identifier)
         {
             arg->type =
-                token->type == CodeTokenType::List ? FunctionArgumentType::List :
-                token->type == CodeTokenType::BlockBody ? FunctionArgumentType::BlockBody :
-                token->type == CodeTokenType::Deferred ? FunctionArgumentType::Deferred :
-                token->type == CodeTokenType::Assignable ? FunctionArgumentType::Assignable :
+                token.type == CodeTokenType::List ? FunctionArgumentType::List :
+                token.type == CodeTokenType::BlockBody ? FunctionArgumentType::BlockBody :
+                token.type == CodeTokenType::Deferred ? FunctionArgumentType::Deferred :
+                token.type == CodeTokenType::Assignable ? FunctionArgumentType::Assignable :
                 FunctionArgumentType::UnKnown;
             if (arg->type == FunctionArgumentType::UnKnown)
             {
                 errors.push_back({
                     CompileErrorType::Parser_InvalidArgumentDeclaration,
-                    token,
-                    "argument should be a single identifier or with a qualifier"
+                    token
                 });
                 return nullptr;
             }
@@ -120,7 +132,7 @@ namespace minimoe
         {
             arg->type = FunctionArgumentType::Normal;
         }
-        arg->name = (*head)->value;
+        arg->name = head->name;
         if (!CheckSingleTokenType(head, tail, CodeTokenType::Identifier, errors))
             return nullptr;
         if (!CheckSingleTokenType(head, tail, CodeTokenType::CloseBracket, errors))
@@ -141,17 +153,62 @@ namespace minimoe
             || type == CodeTokenType::Category;
     }
 
+    DeclarationRange FindDeclaration(LineIter head, LineIter tail)
+    {
+        DEBUGCHECK(head != tail);
+        DeclarationRange range;
+        range.kind = head->front().type;
+        range.first = head;
+        range.endLine = tail;
+        auto it = std::next(head);
+        for (; it != tail; ++it)
+        {
+            DEBUGCHECK(!it->empty());
+            auto type = it->front().type;
+            if (NewDeclaration(type))
+                break;
+            if (type == CodeTokenType::End && range.endLine == tail)
+                range.endLine = it;
+        }
+        range.last = it;
+        if (range.endLine == tail)
+            range.endLine = it;
+        return range;
+    }
+
+    DeclarationRange::List IndexDeclarations(LineIter head, LineIter tail)
+    {
+        DeclarationRange::List ranges;
+        while (head != tail)
+        {
+            ranges.push_back(FindDeclaration(head, tail));
+            head = ranges.back().last;
+        }
+        return ranges;
+    }
+
     FunctionDeclaration::Ptr FunctionDeclaration::Parse(
         LineIter & head, LineIter tail, CompileError::List & errors)
+    {
+        if (CheckEndOfFile(head, tail, errors))
+            return nullptr;
+        auto range = FindDeclaration(head, tail);
+        auto func = Parse(range, errors);
+        head = func != nullptr ? std::next(func->endIter) : range.last;
+        return func;
+    }
+
+    FunctionDeclaration::Ptr FunctionDeclaration::Parse(const DeclarationRange & range, CompileError::List & errors)
     {
         auto func = std::make_shared<FunctionDeclaration>();
+        func->location = DeclarationLocation(range.first, range.last);
 
-        ParseLineFunc ParseFirstLine = [&](TokenIter & tokenIt, TokenIter tokenEnd){
-            auto token = *tokenIt;
+        auto ParseFirstLine = [&](TokenIter & tokenIt, TokenIter tokenEnd){
+            auto & token = *tokenIt;
             FunctionType type =
-                token->type == CodeTokenType::Phrase ? FunctionType::Phrase :
-                token->type == CodeTokenType::Sentence ? FunctionType::Sentence :
-                token->type == CodeTokenType::Block ? FunctionType::Block :
+                token.type == CodeTokenType::Phrase ? FunctionType::Phrase :
+                token.type == CodeTokenType::Sentence ? FunctionType::Sentence :
+                token.type == CodeTokenType::Block ? FunctionType::Block :
                 FunctionType::UnKnown;
             if (type == FunctionType::UnKnown)
                 return false;
@@ -166,7 +223,7 @@ namespace minimoe
             {
                 auto & tk = *tokenIt;
                 auto fragment = std::make_shared<FunctionFragment>();
-                if (tk->type == CodeTokenType::OpenBracket)
+                if (tk.type == CodeTokenType::OpenBracket)
                 {
                     auto decl = ArgumentDeclaration::Parse(tokenIt, tokenEnd, errors);
                     fragment->name = decl->name;
@@ -175,7 +232,7 @@ namespace minimoe
                 }
                 else
                 {
-                    fragment->name = tk->value;
+                    fragment->name = tk.name;
                     if (!CheckSingleTokenType(tokenIt, tokenEnd, CodeTokenType::Identifier, errors))
                         return false;
                     fragment->type = FunctionFragmentType::Name;
@@ -183,10 +240,10 @@ namespace minimoe
                 func->fragments.push_back(fragment);
                 if (tokenIt == tokenEnd)
                     return true;
-                if ((*tokenIt)->type == CodeTokenType::Colon)
+                if (tokenIt->type == CodeTokenType::Colon)
                 {
                     ++tokenIt;
-                    func->alias = (*tokenIt)->value;
+                    func->alias = tokenIt->name;
                     if (!CheckSingleTokenType(tokenIt, tokenEnd, CodeTokenType::Identifier, errors))
                         return false;
                     return true;
@@ -195,98 +252,201 @@ namespace minimoe
             return true;
         };
 
-        auto helper = GenParseLineHelper(head, tail, errors);
+        auto head = range.first;
+        auto helper = GenParseLineHelper(head, range.last, errors);
         if (!helper(ParseFirstLine))
             return nullptr;
 
-        auto it = head;
         func->startIter = head;
-        while (it != tail
-           && (DEBUGCHECK(!(*it)->tokens.empty()), !NewDeclaration((*it)->tokens.front()->type)))
+        if (range.endLine == range.last)
         {
-            ++it;
+            errors.push_back({
+                CompileErrorType::Parser_ExpectEndForFunctionDeclaration,
+                head != range.last ? head->front() : range.first->front()
+            });
+            return nullptr;
         }
-        auto blockEnd = it;
+        CheckParseToLineEnd(std::next(range.endLine->begin()), range.endLine->end(), errors);
+        func->endIter = range.endLine;
+        return func;
+    }
 
-        for (it = head; it != blockEnd; ++it)
+    // parse the declaration of range into module
+    void ParseDeclaration(Module & module, const DeclarationRange & range, CompileError::List & errors)
+    {
+        auto head = range.first;
+        auto tail = range.last;
+        bool parsed = false;
+        switch (range.kind)
         {
-            auto tokens = (*it)->tokens;
-            DEBUGCHECK(!tokens.empty());
-            if (tokens.front()->type == CodeTokenType::End)
-            {
-                CheckParseToLineEnd(std::next(tokens.begin()), tokens.end(), errors);
-                break;
-            }
+        case minimoe::CodeTokenType::Module:
+            module.name = Module::ParseModuleName(head, tail, errors);
+            parsed = !module.name.empty();
+            break;
+        case minimoe::CodeTokenType::Using:
+        {
+            auto usi = UsingDeclaration::Parse(head, tail, errors);
+            if (usi) module.usings.push_back(usi);
+            parsed = usi != nullptr;
+            break;
         }
-        if (it == blockEnd)
+        case minimoe::CodeTokenType::CPS:
+            ERRORMSG("not implemented");
+            break;
+        case minimoe::CodeTokenType::Category:
+            ERRORMSG("not implemented");
+            break;
+        case minimoe::CodeTokenType::Phrase:
+        case minimoe::CodeTokenType::Sentence:
+        case minimoe::CodeTokenType::Block:
         {
-            errors.push_back({
-                CompileErrorType::Parser_ExpectEndForFunctionDeclaration,
-                (*head)->tokens.front(),
-                "function declaration should be end with \"end\""
-            });
-            return nullptr;
+            auto func = FunctionDeclaration::Parse(range, errors);
+            if (func) module.functions.push_back(func);
+            if (func) head = std::next(func->endIter);
+            parsed = func != nullptr;
+            break;
+        }
+        case minimoe::CodeTokenType::Type:
+        {
+            auto type = TypeDeclaration::Parse(head, tail, errors);
+            if (type) module.types.push_back(type);
+            parsed = type != nullptr;
+            break;
+        }
+        case minimoe::CodeTokenType::Tag:
+        {
+            auto tag = TagDeclaration::Parse(head, tail, errors);
+            if (tag) module.tags.push_back(tag);
+            parsed = tag != nullptr;
+            break;
+        }
+        default:
+            // the lines before the first declaration
+            parsed = true;
+            break;
         }
-        func->endIter = it;
-        head = std::next(it);
 
-        return func;
+        // the lines left belong to no declaration, the ones after a failed declaration are told by its errors
+        if (parsed && head != tail)
+            CheckParseToLineEnd(head->begin(), head->end(), errors);
     }
 
     Module::Ptr Module::Parse(const CodeFile::Ptr codeFile, CompileError::List & errors)
     {
+        // each range is parsed right after it's found, while its lines are still in the cache
         auto module = std::make_shared<Module>();
         auto it = codeFile->lines.begin();
         auto itEnd = codeFile->lines.end();
-        while(it != itEnd)
+        while (it != itEnd)
         {
-            auto line = *it;
-            CodeTokenType type = (*line->tokens.begin())->type;
-            switch (type)
-            {
-            case minimoe::CodeTokenType::Module:
-                module->name = ParseModuleName(it, itEnd, errors);
-                break;
-            case minimoe::CodeTokenType::Using:
-            {
-                auto usi = UsingDeclaration::Parse(it, itEnd, errors);
-                if (usi) module->usings.push_back(usi);
-                break;
-            }
-            case minimoe::CodeTokenType::CPS:
-                ERRORMSG("not implemented");
-                break;
-            case minimoe::CodeTokenType::Category:
-                ERRORMSG("not implemented");
-                break;
-            case minimoe::CodeTokenType::Phrase:
-            case minimoe::CodeTokenType::Sentence:
-            case minimoe::CodeTokenType::Block:
+            auto range = FindDeclaration(it, itEnd);
+            ParseDeclaration(*module, range, errors);
+            it = range.last;
+        }
+        return module;
+    }
+
+    Module::Ptr Module::ParseParallel(const CodeFile::Ptr codeFile, ThreadPool & pool, CompileError::List & errors,
+        size_t batchLines)
+    {
+        if (pool.Size() <= 1)
+            return Parse(codeFile, errors);
+        auto ranges = IndexDeclarations(codeFile->lines.begin(), codeFile->lines.end());
+
+        // consecutive declarations, so that appending the batches one by one keeps the source order
+        struct Batch
+        {
+            size_t rangeBegin;
+            size_t rangeEnd;
+            Module module;
+            bool named;
+            CompileError::List errors;
+        };
+        std::vector<std::unique_ptr<Batch>> batches;
+        for (size_t i = 0; i < ranges.size();)
+        {
+            std::unique_ptr<Batch> batch(new Batch());
+            batch->rangeBegin = i;
+            batch->named = false;
+            size_t lineCount = 0;
+            for (; i < ranges.size() && lineCount < batchLines; i++)
+                lineCount += ranges[i].last - ranges[i].first;
+            batch->rangeEnd = i;
+            batches.push_back(std::move(batch));
+        }
+
+        auto module = std::make_shared<Module>();
+        if (batches.size() <= 1)
+        {
+            for (auto & range : ranges)
+                ParseDeclaration(*module, range, errors);
+            return module;
+        }
+
+        // the next batch goes to whichever worker is free, or the calling thread
+        pool.ParallelFor(batches.size(), [&](size_t index){
+            auto & batch = *batches[index];
+            for (size_t i = batch.rangeBegin; i < batch.rangeEnd; i++)
             {
-                auto func = FunctionDeclaration::Parse(it, itEnd, errors);
-                if (func) module->functions.push_back(func);
-                break;
+                ParseDeclaration(batch.module, ranges[i], batch.errors);
+                batch.named = batch.named || ranges[i].kind == CodeTokenType::Module;
             }
-            case minimoe::CodeTokenType::Type:
+        });
+
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            auto & batch = *batches[i];
+            if (batch.named)
+                module->name = batch.module.name;
+            module->usings.insert(module->usings.end(), batch.module.usings.begin(), batch.module.usings.end());
+            module->types.insert(module->types.end(), batch.module.types.begin(), batch.module.types.end());
+            module->tags.insert(module->tags.end(), batch.module.tags.begin(), batch.module.tags.end());
+            module->functions.insert(module->functions.end(), batch.module.functions.begin(), batch.module.functions.end());
+            errors.insert(errors.end(), batch.errors.begin(), batch.errors.end());
+        }
+        return module;
+    }
+
+    Module::Ptr Module::Parse(CodeLineStream & stream, CompileError::List & errors)
+    {
+        auto module = std::make_shared<Module>();
+        CodeLine line;
+        bool hasLine = stream.Next(line);
+        while (hasLine)
+        {
+            // a declaration and the lines before the next one, which is all FunctionDeclaration::Parse looks at
+            CodeLine::List lines;
+            CodeFile::List chunks;
+            do
             {
-                auto type = TypeDeclaration::Parse(it, itEnd, errors);
-                if (type) module->types.push_back(type);
-                break;
-            }
-            case minimoe::CodeTokenType::Tag:
+                lines.push_back(line);
+                if (chunks.empty() || chunks.back() != stream.CurrentChunk())
+                    chunks.push_back(stream.CurrentChunk());
+                hasLine = stream.Next(line);
+            } while (hasLine && !NewDeclaration(line.front().type));
+
+            size_t functionCount = module->functions.size();
+            size_t errorCount = errors.size();
+            ParseDeclaration(*module, FindDeclaration(lines.begin(), lines.end()), errors);
+
+            // functions refer to their lines and errors to the text of their tokens,
+            // the others have copied what they need
+            bool hasFunction = module->functions.size() != functionCount;
+            if (hasFunction)
+                module->streamedLines.push_back(std::move(lines));
+            if (hasFunction || errors.size() != errorCount)
             {
-                auto tag = TagDeclaration::Parse(it, itEnd, errors);
-                if (tag) module->tags.push_back(tag);
-                break;
-            }
-            default:
-                break;
+                for (auto & chunk : chunks)
+                {
+                    if (module->streamedChunks.empty() || module->streamedChunks.back() != chunk)
+                        module->streamedChunks.push_back(chunk);
+                }
             }
         }
         return module;
     }
 
-    string Module::ParseModuleName(LineIter & head, LineIter tail, CompileError::List & errors)
+    Name Module::ParseModuleName(LineIter & head, LineIter tail, CompileError::List & errors)
     {
         return ParseName(head, tail, CodeTokenType::Module, errors);
     }
@@ -296,16 +456,16 @@ namespace minimoe
     ****************/
     std::string UsingDeclaration::ToLog()
     {
-        string s = "Using(" + moduleName + ")";
+        string s = "Using(" + moduleName.ToString() + ")";
         return s;
     }
 
     std::string TypeDeclaration::ToLog()
     {
-        string s = "Type(" + name;
+        string s = "Type(" + name.ToString();
         for (auto & mem : members)
         {
-            s += (", " + mem);
+            s += (", " + mem.ToString());
         }
         s += ")";
         return s;
@@ -313,7 +473,7 @@ namespace minimoe
 
     std::string TagDeclaration::ToLog()
     {
-        return "Tag(" + name + ")";
+        return "Tag(" + name.ToString() + ")";
     }
 
     string ArgumentTypeToString(FunctionArgumentType type)
@@ -331,7 +491,7 @@ namespace minimoe
     {
         string s = ArgumentTypeToString(type);
         s += "(";
-        s += name;
+        s += name.ToString();
         s += ")";
         return s;
     }
@@ -353,12 +513,12 @@ namespace minimoe
             if (fragment->type == FunctionFragmentType::Name)
             {
                 if (!name.empty()) name += "_";
-                name += fragment->name;
+                name += fragment->name.ToString();
             }
             else if (fragment->type == FunctionFragmentType::Argument)
             {
                 if (!argument.empty()) argument += ", ";
-                argument += fragment->name;
+                argument += fragment->name.ToString();
             }
             else ERRORMSG("invalid enum");
         }
@@ -381,7 +541,7 @@ namespace minimoe
         return func;
     }
 
-    FunctionDeclaration::Ptr FunctionDeclaration::name(std::string s)
+    FunctionDeclaration::Ptr FunctionDeclaration::name(Name s)
     {
         auto fragment = std::make_shared<FunctionFragment>();
         fragment->type = FunctionFragmentType::Name;
@@ -390,7 +550,7 @@ namespace minimoe
         return std::dynamic_pointer_cast<FunctionDeclaration>(shared_from_this());
     }
 
-    FunctionDeclaration::Ptr FunctionDeclaration::arg(FunctionArgumentType type, std::string s)
+    FunctionDeclaration::Ptr FunctionDeclaration::arg(FunctionArgumentType type, Name s)
     {
         auto fragment = std::make_shared<FunctionFragment>();
         fragment->type = FunctionFragmentType::Argument;
@@ -3,9 +3,12 @@
 
 #include <memory>
 #include <vector>
+#include <list>
 
 #include "Keyword.h"
 #include "Compiler/Lexer/Lexer.h"
+#include "Compiler/Lexer/CodeLineStream.h"
+#include "Utils/Arena.h"
 
 namespace minimoe
 {
@@ -15,6 +18,8 @@ namespace minimoe
         typedef std::shared_ptr<Declaration> Ptr;
         typedef std::vector<Ptr> List;
 
+        SourceLocation location; // the first token of the declaration
+
         virtual std::string ToLog() = 0;
     };
 
@@ -24,7 +29,7 @@ namespace minimoe
         typedef std::shared_ptr<Declaration> Ptr;
         typedef std::vector<Ptr> List;
 
-        std::string moduleName;
+        Name moduleName;
 
         std::string ToLog() override;
 
@@ -36,8 +41,8 @@ namespace minimoe
     public:
         typedef std::shared_ptr<TypeDeclaration> Ptr;
 
-        std::string name;
-        std::vector<std::string> members;
+        Name name;
+        std::vector<Name> members;
 
         std::string ToLog() override;
 
@@ -49,7 +54,7 @@ namespace minimoe
     public:
         typedef std::shared_ptr<TagDeclaration> Ptr;
 
-        std::string name;
+        Name name;
 
         static Ptr Parse(LineIter & head, LineIter tail, CompileError::List & errors);
         std::string ToLog() override;
@@ -88,7 +93,7 @@ namespace minimoe
         typedef std::vector<Ptr> List;
 
         FunctionFragmentType type;
-        std::string name; // both used for funation name and argument name
+        Name name; // both used for funation name and argument name
     };
 
     class ArgumentDeclaration : public Declaration
@@ -98,13 +103,31 @@ namespace minimoe
         typedef std::vector<Ptr> List;
 
         FunctionArgumentType type;
-        std::string name;
+        Name name;
 
         std::string ToLog() override;
 
         static Ptr Parse(TokenIter & head, TokenIter tail, CompileError::List & errors);
     };
 
+    // the lines of a top level declaration, up to the line the next declaration starts with
+    struct DeclarationRange
+    {
+        typedef std::vector<DeclarationRange> List;
+
+        CodeTokenType kind; // of the first token
+        LineIter first;
+        LineIter last;
+        LineIter endLine;   // the first line starting with end, last if there is none
+    };
+
+    // the declaration starting at head
+    DeclarationRange FindDeclaration(LineIter head, LineIter tail);
+    // all the declarations in one pass over the lines, the lines before the first one are a range too
+    DeclarationRange::List IndexDeclarations(LineIter head, LineIter tail);
+
+    class FunctionBody;
+
     class FunctionDeclaration : public Declaration
     {
     public:
@@ -114,18 +137,21 @@ namespace minimoe
         FunctionFragment::List fragments;
         FunctionType type;
         ArgumentDeclaration::List arguments;
-        std::string alias;
+        Name alias;
 
         LineIter startIter;
         LineIter endIter;
+        // the statements of the lines [startIter, endIter), nullptr until MaterializeBody asks for them
+        std::shared_ptr<FunctionBody> body;
 
         std::string ToLog() override;
 
         static Ptr Make(FunctionType type);
-        FunctionDeclaration::Ptr name(std::string s);
-        FunctionDeclaration::Ptr arg(FunctionArgumentType type, std::string s);
+        FunctionDeclaration::Ptr name(Name s);
+        FunctionDeclaration::Ptr arg(FunctionArgumentType type, Name s);
 
         static Ptr Parse(LineIter & head, LineIter tail, CompileError::List & errors);
+        static Ptr Parse(const DeclarationRange & range, CompileError::List & errors);
     };
 
     enum class Type
@@ -167,14 +193,25 @@ namespace minimoe
         typedef std::shared_ptr<Module> Ptr;
         typedef std::vector<Ptr> List;
 
-        std::string name;
+        Name name;
         UsingDeclaration::List usings;
         TypeDeclaration::List types;
         TagDeclaration::List tags;
         FunctionDeclaration::List functions;
+        // expressions parsed in the functions, freed all together with the module
+        Arena::Ptr arena = std::make_shared<Arena>();
+
+        // lines and tokens referred to by the functions parsed from a CodeLineStream
+        std::list<CodeLine::List> streamedLines;
+        CodeFile::List streamedChunks;
 
         static Ptr Parse(const CodeFile::Ptr codeFile, CompileError::List & errors);
-        static std::string ParseModuleName(LineIter & head, LineIter tail, CompileError::List & errors);
+        // split the declarations into batches of about batchLines lines and parse them on pool,
+        // the declarations and the errors are in the same order as Parse. it may be called from a task of pool
+        static Ptr ParseParallel(const CodeFile::Ptr codeFile, ThreadPool & pool, CompileError::List & errors,
+            size_t batchLines = 1024);
+        static Ptr Parse(CodeLineStream & stream, CompileError::List & errors);
+        static Name ParseModuleName(LineIter & head, LineIter tail, CompileError::List & errors);
     };
 }
 
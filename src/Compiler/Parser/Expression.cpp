@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 #include "ExpressionParser.h"
 #include "Utils/Debug.h"
 
@@ -8,38 +9,138 @@ namespace minimoe
 
     string ErrorTag = "$(ErrorTag)";
 
-    string UnaryExpression::ToLog()
+    string Expression::ToLog()
     {
+        // written in one pass with an explicit stack, so a deep tree takes neither deep recursion
+        // nor copying the logs of its subtrees
+        struct Frame
+        {
+            Expression::Ptr exp;
+            size_t nextChild;
+        };
         string s;
-        s +=
+        std::vector<Frame> frames;
+        auto Enter = [&](Expression::Ptr exp){
+            switch (exp->expressionType)
+            {
+            case ExpressionType::Unary:
+                s += UnaryOperatorToLog(static_cast<UnaryExpression*>(exp)->unaryOperator) + "(";
+                break;
+            case ExpressionType::Binary:
+                s += BinaryOperatorToLog(static_cast<BinaryExpression*>(exp)->binaryOperator) + "(";
+                break;
+            case ExpressionType::Literal:
+                s += static_cast<LiteralExpression*>(exp)->ToLog();
+                return;
+            case ExpressionType::Symbol:
+                s += static_cast<SymbolExpression*>(exp)->ToLog();
+                return;
+            case ExpressionType::FunctionInvoke:
+                s += FunctionNameToLog(static_cast<FunctionInvokeExpression*>(exp)->function) + "(";
+                break;
+            case ExpressionType::List:
+                s += "List(";
+                break;
+            default:
+                ERRORMSG("invalid ExpressionType");
+                s += ErrorTag;
+                return;
+            }
+            frames.push_back({ exp, 0 });
+        };
+
+        Enter(this);
+        while (!frames.empty())
+        {
+            auto & frame = frames.back();
+            if (frame.nextChild == frame.exp->ChildCount())
+            {
+                s += ")";
+                frames.pop_back();
+                continue;
+            }
+            if (frame.nextChild > 0)
+                s += ", ";
+            auto child = frame.exp->Child(frame.nextChild++);
+            Enter(child);
+        }
+        return s;
+    }
+
+    size_t Expression::ChildCount()
+    {
+        switch (expressionType)
+        {
+        case ExpressionType::Unary:
+            return 1;
+        case ExpressionType::Binary:
+            return 2;
+        case ExpressionType::FunctionInvoke:
+            return static_cast<FunctionInvokeExpression*>(this)->arguments.size();
+        case ExpressionType::List:
+            return static_cast<ListExpression*>(this)->elements.size();
+        default:
+            return 0;
+        }
+    }
+
+    Expression::Ptr Expression::Child(size_t index)
+    {
+        DEBUGCHECK(index < ChildCount());
+        switch (expressionType)
+        {
+        case ExpressionType::Unary:
+            return static_cast<UnaryExpression*>(this)->operand;
+        case ExpressionType::Binary:
+            return index == 0
+                ? static_cast<BinaryExpression*>(this)->leftOperand
+                : static_cast<BinaryExpression*>(this)->rightOperand;
+        case ExpressionType::FunctionInvoke:
+            return static_cast<FunctionInvokeExpression*>(this)->arguments[index];
+        case ExpressionType::List:
+            return static_cast<ListExpression*>(this)->elements[index];
+        default:
+            ERRORMSG("no child");
+            return nullptr;
+        }
+    }
+
+    string UnaryOperatorToLog(UnaryOperator unaryOperator)
+    {
+        return
             unaryOperator == UnaryOperator::Negative ? "-" :
             unaryOperator == UnaryOperator::Not ? "not" :
             unaryOperator == UnaryOperator::Positive ? "+" :
             (ERRORMSG("invalid UnaryOperator"), ErrorTag);
-        s += "(" + operand->ToLog() + ")";
-        return s;
     }
 
-    string BinaryExpression::ToLog()
+    string UnaryExpression::ToLog()
     {
-        string s;
-        s +=
-            binaryOperator == BinaryOperator::Add ? "+(" :
-            binaryOperator == BinaryOperator::Sub ? "-(" :
-            binaryOperator == BinaryOperator::Mul ? "*(" :
-            binaryOperator == BinaryOperator::Div ? "/(" :
-            binaryOperator == BinaryOperator::Mod ? "%(" :
-            binaryOperator == BinaryOperator::LT ? "<(" :
-            binaryOperator == BinaryOperator::GT ? ">(" :
-            binaryOperator == BinaryOperator::LE ? "<=(" :
-            binaryOperator == BinaryOperator::GE ? ">=(" :
-            binaryOperator == BinaryOperator::EQ ? "==(" :
-            binaryOperator == BinaryOperator::NE ? "<>(" :
-            binaryOperator == BinaryOperator::And ? "and(" :
-            binaryOperator == BinaryOperator::Or ? "or(" :
+        return Expression::ToLog();
+    }
+
+    string BinaryOperatorToLog(BinaryOperator binaryOperator)
+    {
+        return
+            binaryOperator == BinaryOperator::Add ? "+" :
+            binaryOperator == BinaryOperator::Sub ? "-" :
+            binaryOperator == BinaryOperator::Mul ? "*" :
+            binaryOperator == BinaryOperator::Div ? "/" :
+            binaryOperator == BinaryOperator::Mod ? "%" :
+            binaryOperator == BinaryOperator::LT ? "<" :
+            binaryOperator == BinaryOperator::GT ? ">" :
+            binaryOperator == BinaryOperator::LE ? "<=" :
+            binaryOperator == BinaryOperator::GE ? ">=" :
+            binaryOperator == BinaryOperator::EQ ? "==" :
+            binaryOperator == BinaryOperator::NE ? "<>" :
+            binaryOperator == BinaryOperator::And ? "and" :
+            binaryOperator == BinaryOperator::Or ? "or" :
             (ERRORMSG("invalid BinaryOperator"), ErrorTag);
-        s += leftOperand->ToLog() + ", " + rightOperand->ToLog() + ")";
-        return s;
+    }
+
+    string BinaryExpression::ToLog()
+    {
+        return Expression::ToLog();
     }
 
     std::string TypeToString(Type type)
@@ -55,6 +156,7 @@ namespace minimoe
             type == Type::String ? "String" :
             type == Type::UserDefined ? "Object" :
             type == Type::Tag ? "Tag" :
+            type == Type::Unknown ? "Unknown" :
             (ERRORMSG("invalid Type"), ErrorTag);
     }
 
@@ -75,7 +177,7 @@ namespace minimoe
             (ERRORMSG("invalid Keyword"), ErrorTag);
     }
 
-    string LiteralExpression::ToLog()
+    string LiteralToLog(LiteralType type, const string & value)
     {
         if (type == LiteralType::String)
             return "\"" + value + "\"";
@@ -83,20 +185,25 @@ namespace minimoe
             return value;
     }
 
-    string SymbolExpression::ToLog()
+    string LiteralExpression::ToLog()
+    {
+        return LiteralToLog(type, value);
+    }
+
+    string SymbolToLog(const Symbol::Ptr & symbol)
     {
         string s;
         if (symbol->symbolType == SymbolType::Type)
         {
             if (symbol->builtInType == Type::UserDefined)
-                s += symbol->typeDeclaration->name;
+                s += symbol->typeDeclaration->name.ToString();
             else s += TypeToString(symbol->builtInType);
         }
         else if (symbol->symbolType == SymbolType::Variable)
         {
-            s = "(" + symbol->name + ":";
+            s = "(" + symbol->name.ToString() + ":";
             if (symbol->varDeclaration->type == Type::UserDefined)
-                s += symbol->varDeclaration->userDefinedType->name;
+                s += symbol->varDeclaration->userDefinedType->name.ToString();
             else s += TypeToString(symbol->varDeclaration->type);
             s += ")";
         }
@@ -108,37 +215,33 @@ namespace minimoe
         return s;
     }
 
-    string FunctionInvokeExpression::ToLog()
+    string SymbolExpression::ToLog()
+    {
+        return SymbolToLog(symbol);
+    }
+
+    string FunctionNameToLog(const FunctionDeclaration::Ptr & function)
     {
-        string name, argument;
+        string name;
         for (auto & fragment : function->fragments)
         {
             if (fragment->type == FunctionFragmentType::Name)
             {
                 if (!name.empty()) name += "_";
-                name += fragment->name;
+                name += fragment->name.ToString();
             }
         }
-        for (auto & arg : arguments)
-        {
-            if (!argument.empty()) argument += ", ";
-            argument += arg->ToLog();
-        }
-        string s = name + "(" + argument + ")";
-        return s;
+        return name;
+    }
+
+    string FunctionInvokeExpression::ToLog()
+    {
+        return Expression::ToLog();
     }
 
     string ListExpression::ToLog()
     {
-        string s("List(");
-        for (auto & ele : elements)
-        {
-            if (ele != elements.front())
-                s += ", ";
-            s += ele->ToLog();
-        }
-        s += ")";
-        return s;
+        return Expression::ToLog();
     }
 
 }
@@ -4,10 +4,14 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include "Compiler/Lexer/Lexer.h"
 #include "DeclarationParser.h"
+#include "FunctionTrie.h"
+#include "SymbolTable.h"
 #include "Keyword.h"
+#include "Utils/Arena.h"
 
 namespace minimoe
 {
@@ -36,27 +40,57 @@ namespace minimoe
         Keyword keyword = Keyword::Unknown;   // for true, false, null, only used when SymbolType == SymbolType::Keyword
         VariableDeclaration::Ptr varDeclaration; // only used when SymbolType == SymbolType::Variable
 
-        std::string name;
+        Name name;
 
-        Symbol(Type langBuiltInType, const std::string & symbolName);
-        Symbol(TypeDeclaration::Ptr userDefinedType, const std::string & symbolName);
-        Symbol(Keyword builtInKeyword, Type langBuiltInType, const std::string & symbolName);
-        Symbol(VariableDeclaration::Ptr variable, const std::string & symbolName);
+        Symbol(Type langBuiltInType, Name symbolName);
+        Symbol(TypeDeclaration::Ptr userDefinedType, Name symbolName);
+        Symbol(Keyword builtInKeyword, Type langBuiltInType, Name symbolName);
+        Symbol(VariableDeclaration::Ptr variable, Name symbolName);
     };
 
 
     /****************************
     Expressioin
     ****************************/
+    enum class ExpressionType
+    {
+        Unary,
+        Binary,
+        Literal,
+        Symbol,
+        FunctionInvoke,
+        List,
+    };
+
+    // expressions are allocated in the Arena of the SymbolStack which parses them,
+    // and told apart by expressionType instead of virtual functions
     class Expression
     {
     public:
-        typedef std::shared_ptr<Expression> Ptr;
+        typedef Expression * Ptr;
         typedef std::vector<Ptr> List;
 
-        virtual std::string ToLog() = 0;
+        const ExpressionType expressionType;
+
+        // operands of unary and binary expressions, arguments and elements of the others
+        size_t ChildCount();
+        Ptr Child(size_t index);
+
+        std::string ToLog();
+
+    protected:
+        explicit Expression(ExpressionType type)
+            : expressionType(type)
+        {}
     };
 
+    // nullptr if exp is not a T
+    template<class T>
+    T * ExpressionCast(Expression::Ptr exp)
+    {
+        return exp != nullptr && exp->expressionType == T::ClassType ? static_cast<T*>(exp) : nullptr;
+    }
+
     enum class UnaryOperator
     {
         Positive,
@@ -69,10 +103,16 @@ namespace minimoe
     class UnaryExpression : public Expression
     {
     public:
+        static const ExpressionType ClassType = ExpressionType::Unary;
+
         UnaryOperator unaryOperator;
         Expression::Ptr operand;
 
-        virtual std::string ToLog();
+        UnaryExpression()
+            : Expression(ClassType)
+        {}
+
+        std::string ToLog();
     };
 
     enum class BinaryOperator
@@ -97,11 +137,17 @@ namespace minimoe
     class BinaryExpression : public Expression
     {
     public:
+        static const ExpressionType ClassType = ExpressionType::Binary;
+
         BinaryOperator binaryOperator;
         Expression::Ptr leftOperand;
         Expression::Ptr rightOperand;
 
-        virtual std::string ToLog();
+        BinaryExpression()
+            : Expression(ClassType)
+        {}
+
+        std::string ToLog();
     };
 
     enum class LiteralType
@@ -116,44 +162,77 @@ namespace minimoe
     class LiteralExpression : public Expression
     {
     public:
+        static const ExpressionType ClassType = ExpressionType::Literal;
+
         LiteralType type;
         std::string value;
 
-        virtual std::string ToLog();
+        LiteralExpression()
+            : Expression(ClassType)
+        {}
+
+        std::string ToLog();
     };
 
     // reference for types, built in values, variables
     class SymbolExpression : public Expression
     {
     public:
+        static const ExpressionType ClassType = ExpressionType::Symbol;
+
         Symbol::Ptr symbol;  // we can find declaration here
 
-        virtual std::string ToLog();
+        SymbolExpression()
+            : Expression(ClassType)
+        {}
+
+        std::string ToLog();
     };
 
     // FunctionNamePart1(ParamExpression1)Part2(ParamExpression2)Part3 ...
     class FunctionInvokeExpression : public Expression
     {
     public:
+        static const ExpressionType ClassType = ExpressionType::FunctionInvoke;
+
         FunctionDeclaration::Ptr function;
         Expression::List arguments;
 
-        virtual std::string ToLog();
+        FunctionInvokeExpression()
+            : Expression(ClassType)
+        {}
+
+        std::string ToLog();
     };
 
     // (element1, element2, element3...)
     class ListExpression : public Expression
     {
     public:
+        static const ExpressionType ClassType = ExpressionType::List;
+
         Expression::List elements;
 
-        virtual std::string ToLog();
+        ListExpression()
+            : Expression(ClassType)
+        {}
+
+        std::string ToLog();
     };
 
+    // parts of the logs of expressions
+    std::string UnaryOperatorToLog(UnaryOperator unaryOperator);
+    std::string BinaryOperatorToLog(BinaryOperator binaryOperator);
+    std::string LiteralToLog(LiteralType type, const std::string & value);
+    std::string SymbolToLog(const Symbol::Ptr & symbol);
+    std::string FunctionNameToLog(const FunctionDeclaration::Ptr & function);
+
     /****************************
     SymbolStack
     ****************************/
 
+    class SymbolStack;
+
     class SymbolStackItem
     {
     public:
@@ -161,7 +240,9 @@ namespace minimoe
         typedef std::vector<Ptr> List;
 
         FunctionDeclaration::List functionTables;
-        Symbol::List symbolTables;
+        // index of functionTables, functions appended to functionTables are indexed when parsing the next invoking
+        FunctionTrie functionTrie;
+        Symbol::List symbolTables; // add symbols by addSymbol, which also indexes them when the item is pushed
 
         void LoadPredefinedSymbol();
 
@@ -170,38 +251,97 @@ namespace minimoe
         {
             auto symbol = std::make_shared<Symbol>(std::forward<Params>(params)...);
             symbolTables.push_back(symbol);
+            IndexSymbol(symbol);
         }
+
+    private:
+        friend class SymbolStack;
+
+        void IndexSymbol(const Symbol::Ptr & symbol);
+
+        SymbolStack * stack = nullptr; // the stack it's pushed to
+        size_t scope = 0;
     };
 
     class SymbolStack
     {
     public:
-        typedef Expression::Ptr(SymbolStack::* ParseFunctionType)(TokenIter&, TokenIter, CompileError::List&);
-
         SymbolStackItem::List stackItems;
-        
+        // where the parsed expressions live, shared with the Module they are parsed for
+        Arena::Ptr arena;
+        // packrat parsing, cache the expressions in brackets and the arguments by the token they start from,
+        // so that backtracking never parses the same tokens as an expression twice.
+        // the cache only lives during one call of the parsing functions below
+        bool memoization = false;
+        // how deep brackets, unary operators, function invoking and pending binary operators may nest in an expression,
+        // the deeper ones are Parser_ExpressionTooDeep
+        size_t maxDepth = 1024;
+
+        SymbolStack();
+        ~SymbolStack();
+
         void Push(SymbolStackItem::Ptr item);
         void Pop();
         SymbolStackItem::Ptr Top();
-        Symbol::Ptr ResolveSymbol(std::string name);
+        Symbol::Ptr ResolveSymbol(Name name);
 
         Expression::Ptr ParseExpression(TokenIter & head, TokenIter tail, CompileError::List & errors);
-        Expression::Ptr ParseBinary(TokenIter & head, TokenIter tail, ParseFunctionType innerParser,
-            CodeTokenType tokenTypes[], BinaryOperator binaryOpTypes[], size_t count, CompileError::List & errors);
-        Expression::Ptr ParseOr(TokenIter & head, TokenIter tail, CompileError::List & errors);
-        Expression::Ptr ParseAnd(TokenIter & head, TokenIter tail, CompileError::List & errors);
         Expression::Ptr ParsePrimitive(TokenIter & head, TokenIter tail, CompileError::List & errors);
 
         // include types, built in values, variables
         Expression::Ptr ParseSymbol(TokenIter & head, TokenIter tail, CompileError::List & errors);
+        // only a function invoking, the errors tell why each candidate fails if none matches
         Expression::Ptr ParseInvokeFunction(TokenIter & head, TokenIter tail, CompileError::List & errors);
         Expression::Ptr ParseOneFunction(TokenIter & head, TokenIter tail,
             FunctionDeclaration::Ptr function, CompileError::List & errors);
-        Expression::Ptr ParseFunctionArgumentFragment(TokenIter & head, TokenIter tail, CompileError::List & errors);
-        bool CheckFunctionNameFragment(TokenIter & head, TokenIter tail,
-            const std::string & name, CompileError::List & errors);
 
+        // only a list, (1) is not one
         Expression::Ptr ParseList(TokenIter & head, TokenIter tail, CompileError::List & errors);
+
+    private:
+        friend class SymbolStackItem;
+        class StackParser;
+
+        // where ParseByStack starts from
+        enum class StackEntry
+        {
+            Expression,
+            Primitive,
+            Function,
+            List,
+        };
+
+        struct MemoKey
+        {
+            const CodeToken * token;
+            StackEntry rule;
+
+            bool operator==(const MemoKey & other) const { return token == other.token && rule == other.rule; }
+        };
+
+        struct MemoKeyHash
+        {
+            size_t operator()(const MemoKey & key) const
+            {
+                return std::hash<const CodeToken*>()(key.token) * 4 + static_cast<size_t>(key.rule);
+            }
+        };
+
+        struct MemoEntry
+        {
+            Expression::Ptr exp;
+            TokenIter end;
+            CompileError::List errors; // appended by the rule, replayed on every hit
+        };
+
+        // all the parsing rules above are this one without recursion, see StackParser.cpp.
+        // function is the only candidate for StackEntry::Function if not null
+        Expression::Ptr ParseByStack(TokenIter & head, TokenIter tail, StackEntry entry, CompileError::List & errors,
+            const FunctionDeclaration::Ptr * function = nullptr);
+
+        SymbolTable symbolTable;
+        std::shared_ptr<StackParser> stackParser;
+        std::unordered_map<MemoKey, MemoEntry, MemoKeyHash> memoTable;
     };
 
 
@@ -0,0 +1,165 @@
+#include "FlatExpression.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    using std::string;
+
+    FlatExpressionTree::NodeIndex FlatExpressionTree::Append(Expression::Ptr root)
+    {
+        // depth first with an explicit stack, a node is appended when all the subtrees of its children are,
+        // so any deep tree the parser makes can be appended
+        struct Frame
+        {
+            Expression::Ptr exp;
+            size_t nextChild;
+            NodeIndex subtreeBegin;
+            uint8_t op;
+            uint32_t payload;
+            size_t childRootsBegin; // the roots of the children appended are childRoots[childRootsBegin, end)
+        };
+        std::vector<Frame> frames;
+        std::vector<NodeIndex> childRoots;
+
+        auto Enter = [&](Expression::Ptr exp){
+            CHECKNULL(exp);
+            uint8_t op = 0;
+            uint32_t payload = 0;
+            switch (exp->expressionType)
+            {
+            case ExpressionType::Unary:
+                op = static_cast<uint8_t>(static_cast<UnaryExpression*>(exp)->unaryOperator);
+                break;
+            case ExpressionType::Binary:
+                op = static_cast<uint8_t>(static_cast<BinaryExpression*>(exp)->binaryOperator);
+                break;
+            case ExpressionType::Literal:
+                {
+                    auto literalExp = static_cast<LiteralExpression*>(exp);
+                    op = static_cast<uint8_t>(literalExp->type);
+                    payload = static_cast<uint32_t>(literalValues.size());
+                    literalValues.push_back(literalExp->value);
+                    break;
+                }
+            case ExpressionType::Symbol:
+                payload = static_cast<uint32_t>(symbols.size());
+                symbols.push_back(static_cast<SymbolExpression*>(exp)->symbol);
+                break;
+            case ExpressionType::FunctionInvoke:
+                payload = static_cast<uint32_t>(functions.size());
+                functions.push_back(static_cast<FunctionInvokeExpression*>(exp)->function);
+                break;
+            case ExpressionType::List:
+                break;
+            default:
+                ERRORMSG("invalid ExpressionType");
+            }
+            frames.push_back({ exp, 0, static_cast<NodeIndex>(Size()), op, payload, childRoots.size() });
+        };
+
+        Enter(root);
+        while (true)
+        {
+            auto & frame = frames.back();
+            if (frame.nextChild < frame.exp->ChildCount())
+            {
+                auto child = frame.exp->Child(frame.nextChild++);
+                Enter(child);
+                continue;
+            }
+
+            // the subtrees of the children are all appended, so the child indexes of this node are contiguous
+            children.insert(children.end(), childRoots.begin() + frame.childRootsBegin, childRoots.end());
+            childRoots.resize(frame.childRootsBegin);
+            childBegins.push_back(static_cast<uint32_t>(children.size()));
+            types.push_back(frame.exp->expressionType);
+            operators.push_back(frame.op);
+            payloads.push_back(frame.payload);
+            subtreeBegins.push_back(frame.subtreeBegin);
+            frames.pop_back();
+
+            auto node = static_cast<NodeIndex>(Size() - 1);
+            if (frames.empty())
+                return node;
+            childRoots.push_back(node);
+        }
+    }
+
+    UnaryOperator FlatExpressionTree::GetUnaryOperator(NodeIndex node) const
+    {
+        DEBUGCHECK(types[node] == ExpressionType::Unary);
+        return static_cast<UnaryOperator>(operators[node]);
+    }
+
+    BinaryOperator FlatExpressionTree::GetBinaryOperator(NodeIndex node) const
+    {
+        DEBUGCHECK(types[node] == ExpressionType::Binary);
+        return static_cast<BinaryOperator>(operators[node]);
+    }
+
+    LiteralType FlatExpressionTree::GetLiteralType(NodeIndex node) const
+    {
+        DEBUGCHECK(types[node] == ExpressionType::Literal);
+        return static_cast<LiteralType>(operators[node]);
+    }
+
+    const std::string & FlatExpressionTree::GetLiteralValue(NodeIndex node) const
+    {
+        DEBUGCHECK(types[node] == ExpressionType::Literal);
+        return literalValues[payloads[node]];
+    }
+
+    const Symbol::Ptr & FlatExpressionTree::GetSymbol(NodeIndex node) const
+    {
+        DEBUGCHECK(types[node] == ExpressionType::Symbol);
+        return symbols[payloads[node]];
+    }
+
+    const FunctionDeclaration::Ptr & FlatExpressionTree::GetFunction(NodeIndex node) const
+    {
+        DEBUGCHECK(types[node] == ExpressionType::FunctionInvoke);
+        return functions[payloads[node]];
+    }
+
+    string FlatExpressionTree::ToLog(NodeIndex root) const
+    {
+        // logs of the nodes of the tree, children are always done before their parent
+        NodeIndex begin = subtreeBegins[root];
+        std::vector<string> logs(root - begin + 1);
+        auto JoinChildren = [&](NodeIndex node){
+            string s;
+            for (auto child : Children(node))
+            {
+                if (!s.empty()) s += ", ";
+                s += logs[child - begin];
+            }
+            return s;
+        };
+
+        VisitPostOrder(root, [&](NodeIndex node){
+            auto & log = logs[node - begin];
+            switch (types[node])
+            {
+            case ExpressionType::Unary:
+                log = UnaryOperatorToLog(GetUnaryOperator(node)) + "(" + JoinChildren(node) + ")";
+                break;
+            case ExpressionType::Binary:
+                log = BinaryOperatorToLog(GetBinaryOperator(node)) + "(" + JoinChildren(node) + ")";
+                break;
+            case ExpressionType::Literal:
+                log = LiteralToLog(GetLiteralType(node), GetLiteralValue(node));
+                break;
+            case ExpressionType::Symbol:
+                log = SymbolToLog(GetSymbol(node));
+                break;
+            case ExpressionType::FunctionInvoke:
+                log = FunctionNameToLog(GetFunction(node)) + "(" + JoinChildren(node) + ")";
+                break;
+            case ExpressionType::List:
+                log = "List(" + JoinChildren(node) + ")";
+                break;
+            }
+        });
+        return logs.back();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef MINIMOE_FLAT_EXPRESSION_H
+#define MINIMOE_FLAT_EXPRESSION_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "ExpressionParser.h"
+
+namespace minimoe
+{
+    // a contiguous range of an array owned by someone else
+    template<class T>
+    class ArraySpan
+    {
+    public:
+        ArraySpan(const T * _first, size_t _size)
+            : first(_first), length(_size)
+        {}
+
+        const T * begin() const { return first; }
+        const T * end() const { return first + length; }
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+        const T & operator[](size_t i) const { return first[i]; }
+
+    private:
+        const T * first;
+        size_t length;
+    };
+
+    // expression trees in a structure of arrays, the fields of node i are the i-th elements of the arrays.
+    // nodes are appended in post order, so the children of a node are before it,
+    // and a tree takes the nodes [SubtreeBegin(root), root]
+    class FlatExpressionTree
+    {
+    public:
+        typedef uint32_t NodeIndex;
+
+        // append the nodes of the tree of exp, return the index of its root
+        NodeIndex Append(Expression::Ptr exp);
+
+        size_t Size() const { return types.size(); }
+        ExpressionType Type(NodeIndex node) const { return types[node]; }
+        NodeIndex SubtreeBegin(NodeIndex node) const { return subtreeBegins[node]; }
+        // operands of unary and binary expressions, arguments and elements of the others
+        ArraySpan<NodeIndex> Children(NodeIndex node) const
+        {
+            return ArraySpan<NodeIndex>(children.data() + childBegins[node], childBegins[node + 1] - childBegins[node]);
+        }
+
+        UnaryOperator GetUnaryOperator(NodeIndex node) const;
+        BinaryOperator GetBinaryOperator(NodeIndex node) const;
+        LiteralType GetLiteralType(NodeIndex node) const;
+        const std::string & GetLiteralValue(NodeIndex node) const;
+        const Symbol::Ptr & GetSymbol(NodeIndex node) const;
+        const FunctionDeclaration::Ptr & GetFunction(NodeIndex node) const;
+
+        // visitor(node) for all the nodes of the tree of root, children before parents
+        template<class Visitor>
+        void VisitPostOrder(NodeIndex root, Visitor visitor) const
+        {
+            for (NodeIndex node = subtreeBegins[root]; node <= root; node++)
+                visitor(node);
+        }
+
+        // the same as Expression::ToLog, by a post order scan
+        std::string ToLog(NodeIndex root) const;
+
+    private:
+        std::vector<ExpressionType> types;
+        std::vector<uint8_t> operators;  // UnaryOperator, BinaryOperator or LiteralType
+        std::vector<uint32_t> payloads;  // index of literalValues, symbols or functions
+        std::vector<NodeIndex> subtreeBegins;
+        std::vector<uint32_t> childBegins = std::vector<uint32_t>(1, 0); // children of node i are [childBegins[i], childBegins[i + 1])
+        std::vector<NodeIndex> children;
+
+        std::vector<std::string> literalValues;
+        Symbol::List symbols;
+        FunctionDeclaration::List functions;
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "FunctionBody.h"
+#include "UtilsParser.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    using std::string;
+
+    /*******************
+    Parse
+    ********************/
+    namespace
+    {
+        Statement::Ptr ParseStatement(TokenIter & head, TokenIter tail, FunctionBody & body, SymbolStack & stack)
+        {
+            auto statement = std::make_shared<Statement>();
+            statement->location = head->location;
+            auto & errors = body.errors;
+            if (head->type == CodeTokenType::Var)
+            {
+                ++head;
+                if (CheckReachTheEnd(head, tail, errors))
+                    return nullptr;
+                Name name = head->name;
+                if (!CheckSingleTokenType(head, tail, CodeTokenType::Identifier, errors))
+                    return nullptr;
+                if (CheckReachTheEnd(head, tail, errors))
+                    return nullptr;
+                if (!CheckSingleTokenType(head, tail, CodeTokenType::Assign, errors))
+                    return nullptr;
+                auto value = stack.ParseExpression(head, tail, errors);
+                if (value == nullptr)
+                    return nullptr;
+
+                // visible from the next line
+                auto variable = std::make_shared<VariableDeclaration>();
+                variable->location = statement->location;
+                variable->type = Type::Unknown;
+                body.symbols->addSymbol(variable, name);
+                statement->statementType = StatementType::Var;
+                statement->variable = variable;
+                statement->variableName = name;
+                statement->value = value;
+                return statement;
+            }
+
+            auto exp = stack.ParseExpression(head, tail, errors);
+            if (exp == nullptr)
+                return nullptr;
+            if (!CheckSingleTokenType(head, tail, CodeTokenType::Assign))
+            {
+                statement->statementType = StatementType::Expression;
+                statement->value = exp;
+                return statement;
+            }
+            auto value = stack.ParseExpression(head, tail, errors);
+            if (value == nullptr)
+                return nullptr;
+            statement->statementType = StatementType::Assignment;
+            statement->target = exp;
+            statement->value = value;
+            return statement;
+        }
+
+        FunctionBody::Ptr ParseBody(const FunctionDeclaration::Ptr & function, SymbolStack & stack)
+        {
+            auto body = std::make_shared<FunctionBody>();
+            body->symbols = std::make_shared<SymbolStackItem>();
+            body->symbols->addSymbol(Keyword::FunctioinResult, Type::Unknown, "result");
+            for (auto & argument : function->arguments)
+            {
+                auto variable = std::make_shared<VariableDeclaration>();
+                variable->location = argument->location;
+                variable->type = Type::Unknown;
+                body->symbols->addSymbol(variable, argument->name);
+            }
+
+            stack.Push(body->symbols);
+            for (auto it = function->startIter; it != function->endIter; ++it)
+            {
+                auto head = it->begin();
+                auto tail = it->end();
+                auto statement = ParseStatement(head, tail, *body, stack);
+                if (statement == nullptr)
+                    continue;
+                body->statements.push_back(statement);
+                CheckParseToLineEnd(head, tail, body->errors);
+            }
+            stack.Pop();
+            return body;
+        }
+    }
+
+    FunctionBody::Ptr MaterializeBody(const FunctionDeclaration::Ptr & function, SymbolStack & stack)
+    {
+        if (function->body == nullptr)
+            function->body = ParseBody(function, stack);
+        return function->body;
+    }
+
+    /*******************
+    ToLog
+    ********************/
+    string Statement::ToLog()
+    {
+        return
+            statementType == StatementType::Expression ? value->ToLog() :
+            statementType == StatementType::Assignment ? "Assign(" + target->ToLog() + ", " + value->ToLog() + ")" :
+            statementType == StatementType::Var ? "Var(" + variableName.ToString() + ", " + value->ToLog() + ")" :
+            (ERRORMSG("invalid StatementType"), "");
+    }
+
+    string FunctionBody::ToLog()
+    {
+        string s;
+        for (auto & statement : statements)
+            s += statement->ToLog() + "\n";
+        return s;
+    }
+}
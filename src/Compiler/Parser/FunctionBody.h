@@ -0,0 +1,58 @@
+#ifndef MINIMOE_FUNCTION_BODY_H
+#define MINIMOE_FUNCTION_BODY_H
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "ExpressionParser.h"
+
+namespace minimoe
+{
+    enum class StatementType
+    {
+        Expression,     // value
+        Assignment,     // target = value
+        Var,            // var variable = value
+
+        UnKnown,
+    };
+
+    // a line of a function body
+    class Statement
+    {
+    public:
+        typedef std::shared_ptr<Statement> Ptr;
+        typedef std::vector<Ptr> List;
+
+        StatementType statementType = StatementType::UnKnown;
+        SourceLocation location;
+        Expression::Ptr target;                 // only used when statementType == StatementType::Assignment
+        VariableDeclaration::Ptr variable;      // only used when statementType == StatementType::Var
+        Name variableName;
+        Expression::Ptr value;
+
+        std::string ToLog();
+    };
+
+    class FunctionBody
+    {
+    public:
+        typedef std::shared_ptr<FunctionBody> Ptr;
+
+        // the arguments, result and the variables declared in the body
+        SymbolStackItem::Ptr symbols;
+        Statement::List statements;
+        CompileError::List errors;
+
+        std::string ToLog();
+    };
+
+    // the body of function, parsed on the first call and cached on the declaration, so that the functions
+    // never asked for cost nothing more than their first line. stack has the symbols the body may refer to,
+    // and its arena should live as long as the declaration, the arena of the module usually.
+    // not thread safe for the same declaration
+    FunctionBody::Ptr MaterializeBody(const FunctionDeclaration::Ptr & function, SymbolStack & stack);
+}
+
+#endif
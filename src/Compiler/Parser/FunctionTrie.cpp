@@ -0,0 +1,103 @@
+#include <algorithm>
+
+#include "FunctionTrie.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    FunctionTrie::FunctionTrie()
+        : nodes(1), indexedCount(0)
+    {}
+
+    void FunctionTrie::Update(const FunctionDeclaration::List & functions)
+    {
+        for (; indexedCount < functions.size(); indexedCount++)
+        {
+            size_t node = 0;
+            for (auto & fragment : functions[indexedCount]->fragments)
+            {
+                size_t child = NoNode;
+                if (fragment->type == FunctionFragmentType::Name)
+                {
+                    auto it = nodes[node].names.find(fragment->name);
+                    if (it != nodes[node].names.end())
+                        child = it->second;
+                }
+                else child = nodes[node].argument;
+
+                if (child == NoNode)
+                {
+                    child = nodes.size();
+                    if (fragment->type == FunctionFragmentType::Name)
+                        nodes[node].names[fragment->name] = child;
+                    else nodes[node].argument = child;
+                    nodes.emplace_back();
+                }
+                node = child;
+            }
+            nodes[node].functions.push_back(indexedCount);
+        }
+    }
+
+    void FunctionTrie::FindCandidates(TokenIter head, TokenIter tail, std::vector<size_t> & candidates) const
+    {
+        size_t candidateBegin = candidates.size();
+        size_t node = 0;
+        while (head != tail)
+        {
+            size_t child = NoNode;
+            if (head->type == CodeTokenType::Identifier)
+            {
+                auto it = nodes[node].names.find(head->name);
+                if (it != nodes[node].names.end())
+                {
+                    child = it->second;
+                    ++head;
+                }
+            }
+            else if (head->type == CodeTokenType::OpenBracket && nodes[node].argument != NoNode)
+            {
+                // skip the argument, it's parsed later only for the candidates
+                size_t depth = 0;
+                auto it = head;
+                for (; it != tail; ++it)
+                {
+                    if (it->type == CodeTokenType::OpenBracket)
+                        depth++;
+                    else if (it->type == CodeTokenType::CloseBracket && --depth == 0)
+                        break;
+                }
+                if (it != tail)
+                {
+                    child = nodes[node].argument;
+                    head = std::next(it);
+                }
+            }
+            if (child == NoNode)
+                break;
+            node = child;
+            candidates.insert(candidates.end(), nodes[node].functions.begin(), nodes[node].functions.end());
+        }
+        std::sort(candidates.begin() + candidateBegin, candidates.end());
+
+        // nothing matched if still at the root, the tokens are not a function at all
+        if (node == 0)
+            return;
+        std::vector<size_t> partial;
+        for (auto & name : nodes[node].names)
+            CollectFunctions(name.second, partial);
+        if (nodes[node].argument != NoNode)
+            CollectFunctions(nodes[node].argument, partial);
+        std::sort(partial.begin(), partial.end());
+        candidates.insert(candidates.end(), partial.begin(), partial.end());
+    }
+
+    void FunctionTrie::CollectFunctions(size_t node, std::vector<size_t> & functions) const
+    {
+        functions.insert(functions.end(), nodes[node].functions.begin(), nodes[node].functions.end());
+        for (auto & name : nodes[node].names)
+            CollectFunctions(name.second, functions);
+        if (nodes[node].argument != NoNode)
+            CollectFunctions(nodes[node].argument, functions);
+    }
+}
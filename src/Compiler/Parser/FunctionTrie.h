@@ -0,0 +1,49 @@
+#ifndef MINIMOE_FUNCTION_TRIE_H
+#define MINIMOE_FUNCTION_TRIE_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "Compiler/Lexer/Lexer.h"
+#include "DeclarationParser.h"
+
+namespace minimoe
+{
+    // prefix tree of the fragments of functions, a name fragment is matched by an identifier
+    // and an argument fragment by any tokens in a pair of brackets.
+    // used to find the functions which may be invoked by the tokens without trying all of them
+    class FunctionTrie
+    {
+    public:
+        FunctionTrie();
+
+        // functions are only appended, the ones not indexed yet are added here
+        void Update(const FunctionDeclaration::List & functions);
+
+        // append the indexes in functions of the functions whose fragments are all matched by the tokens from head,
+        // in the order of functions. then the ones which are only matched partially, they can't be invoked
+        // but tell why the tokens are not a function invoking
+        void FindCandidates(TokenIter head, TokenIter tail, std::vector<size_t> & candidates) const;
+
+    private:
+        static const size_t NoNode = 0; // the root is never a child
+
+        struct Node
+        {
+            std::unordered_map<Name, size_t, NameHash> names;
+            size_t argument;
+            std::vector<size_t> functions; // whose last fragment ends here
+
+            Node()
+                : argument(NoNode)
+            {}
+        };
+
+        void CollectFunctions(size_t node, std::vector<size_t> & functions) const;
+
+        std::vector<Node> nodes;
+        size_t indexedCount;
+    };
+}
+
+#endif
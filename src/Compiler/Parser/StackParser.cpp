@@ -0,0 +1,761 @@
+#include "ExpressionParser.h"
+#include "UtilsParser.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    namespace
+    {
+        struct BinaryOperatorInfo
+        {
+            BinaryOperator binaryOperator;
+            int precedence; // higher binds tighter, 0 for the tokens which are not binary operators
+        };
+
+        struct BinaryOperatorTable
+        {
+            BinaryOperatorInfo operators[static_cast<int>(CodeTokenType::UnKnown) + 1];
+        };
+
+        BinaryOperatorTable BuildBinaryOperatorTable()
+        {
+            BinaryOperatorTable table;
+            for (auto & info : table.operators)
+                info = { BinaryOperator::UnKnown, 0 };
+            auto set = [&](CodeTokenType type, BinaryOperator binaryOperator, int precedence){
+                table.operators[static_cast<int>(type)] = { binaryOperator, precedence };
+            };
+            set(CodeTokenType::Or, BinaryOperator::Or, 1);
+            set(CodeTokenType::And, BinaryOperator::And, 2);
+            set(CodeTokenType::LT, BinaryOperator::LT, 3);
+            set(CodeTokenType::GT, BinaryOperator::GT, 3);
+            set(CodeTokenType::LE, BinaryOperator::LE, 3);
+            set(CodeTokenType::GE, BinaryOperator::GE, 3);
+            set(CodeTokenType::EQ, BinaryOperator::EQ, 3);
+            set(CodeTokenType::NE, BinaryOperator::NE, 3);
+            set(CodeTokenType::Add, BinaryOperator::Add, 4);
+            set(CodeTokenType::Sub, BinaryOperator::Sub, 4);
+            set(CodeTokenType::Mul, BinaryOperator::Mul, 5);
+            set(CodeTokenType::Div, BinaryOperator::Div, 5);
+            set(CodeTokenType::Mod, BinaryOperator::Mod, 5);
+            return table;
+        }
+
+        const BinaryOperatorInfo & GetBinaryOperator(CodeTokenType type)
+        {
+            static const BinaryOperatorTable table = BuildBinaryOperatorTable();
+            return table.operators[static_cast<int>(type)];
+        }
+    }
+
+    // the only grammar of the expressions, with the binary operators by shunting yard.
+    // the brackets, unary operators and function invoking still waiting for their operands are kept
+    // in the stacks here instead of the call stack, so only maxDepth bounds how deep they nest.
+    // the trees and the errors are the same as parsing them recursively.
+    // ParseInvokeFunction, ParseOneFunction and ParseList start from a function or a list frame
+    // which tells why it fails instead of trying the other rules
+    class SymbolStack::StackParser
+    {
+    public:
+        StackParser(SymbolStack & _symbols)
+            : symbols(_symbols)
+        {}
+
+        Expression::Ptr Parse(TokenIter & _head, TokenIter _tail, StackEntry entry, CompileError::List & _errors,
+            const FunctionDeclaration::Ptr * function)
+        {
+            DEBUGCHECK_WITH_MSG(frames.empty(), "StackParser is not reentrant");
+            head = _head;
+            tail = _tail;
+            errors = &_errors;
+            rootCheckpoint = errors->size();
+            value = nullptr;
+            frames.push_back(NewFrame(FrameType::Root));
+            frames.back().primaryOnly = entry != StackEntry::Expression;
+            BeginExpression();
+
+            Step step =
+                entry == StackEntry::Function ? StartFunction(function) :
+                entry == StackEntry::List ? StartList() :
+                Step::Primary;
+            while (step != Step::Finished)
+            {
+                switch (step)
+                {
+                case Step::Primary:
+                    step = StartPrimary(true);
+                    break;
+                case Step::PrimaryNotFunction:
+                    step = StartPrimary(false);
+                    break;
+                case Step::AfterPrimary:
+                    step = AfterPrimary();
+                    break;
+                case Step::PrimaryFailed:
+                    step = PrimaryFailed();
+                    break;
+                case Step::ExpressionFinished:
+                    step = ExpressionFinished();
+                    break;
+                case Step::ExpressionFailed:
+                    step = ExpressionFailed();
+                    break;
+                default:
+                    ERRORMSG("invalid Step");
+                }
+            }
+
+            frames.clear();
+            operands.clear();
+            operators.clear();
+            collected.clear();
+            candidates.clear();
+            _head = head;
+            return value;
+        }
+
+    private:
+        enum class Step
+        {
+            Primary,            // parse a primary expression from head
+            PrimaryNotFunction, // the same, after all the function invoking candidates failed
+            AfterPrimary,       // value is the primary
+            PrimaryFailed,      // the errors tell why
+            ExpressionFinished, // value is the expression of the top frame
+            ExpressionFailed,
+            Finished,           // value is the result
+        };
+
+        // where the expression parsed in a frame goes
+        enum class FrameType
+        {
+            Root,       // returned by Parse
+            Bracket,    // an expression in brackets, or an element of a list
+            Function,   // an argument of the current function invoking candidate
+        };
+
+        struct Frame
+        {
+            FrameType frameType;
+            // the expression parsed in the frame
+            TokenIter start;
+            size_t errorCheckpoint;
+            size_t operandBase;
+            size_t operatorBase;
+            // elements of the list or arguments of the function are collected[collectedBase:]
+            size_t collectedBase;
+
+            // Root
+            bool primaryOnly;
+            // Bracket and Function, started by StartList or StartFunction
+            bool reportErrors;
+            // Bracket
+            bool isList;
+            TokenIter firstComma;
+            // Function, candidates[candidate:candidateEnd] are not tried yet
+            TokenIter functionStart;
+            size_t functionCheckpoint;
+            size_t candidateBase;
+            size_t candidate;
+            size_t candidateEnd;
+            size_t fragment;
+        };
+
+        struct PendingOperator
+        {
+            bool isUnary;
+            UnaryOperator unaryOperator;
+            BinaryOperator binaryOperator;
+            int precedence;
+            TokenIter token;
+            size_t errorCheckpoint; // the errors after it are dropped if its operand is not found
+        };
+
+        struct Candidate
+        {
+            const FunctionDeclaration::Ptr * function; // in the functionTables of a stack item
+        };
+
+        Frame NewFrame(FrameType frameType)
+        {
+            Frame frame;
+            frame.frameType = frameType;
+            frame.start = head;
+            frame.errorCheckpoint = errors->size();
+            frame.operandBase = operands.size();
+            frame.operatorBase = operators.size();
+            frame.collectedBase = collected.size();
+            frame.primaryOnly = false;
+            frame.reportErrors = false;
+            frame.isList = false;
+            frame.candidateBase = candidates.size();
+            frame.candidate = frame.candidateEnd = candidates.size();
+            frame.fragment = 0;
+            return frame;
+        }
+
+        void PopFrame()
+        {
+            auto & frame = frames.back();
+            operands.resize(frame.operandBase);
+            operators.resize(frame.operatorBase);
+            collected.resize(frame.collectedBase);
+            candidates.resize(frame.candidateBase);
+            frames.pop_back();
+        }
+
+        // the frames and the pending operators are where the recursion would be
+        bool CheckDepth()
+        {
+            if (frames.size() + operators.size() < symbols.maxDepth)
+                return true;
+            // not a failed attempt of some rule, so nothing could take it back
+            errors->resize(rootCheckpoint);
+            errors->push_back({
+                CompileErrorType::Parser_ExpressionTooDeep,
+                *head
+            });
+            head = frames.front().start;
+            value = nullptr;
+            return false;
+        }
+
+        Step BeginExpression()
+        {
+            auto & frame = frames.back();
+            frame.start = head;
+            frame.errorCheckpoint = errors->size();
+            fromMemo = false;
+            if (!symbols.memoization || frame.frameType == FrameType::Root || head == tail)
+                return Step::Primary;
+
+            auto it = symbols.memoTable.find({ &*head, StackEntry::Expression });
+            if (it == symbols.memoTable.end())
+                return Step::Primary;
+            auto & entry = it->second;
+            errors->insert(errors->end(), entry.errors.begin(), entry.errors.end());
+            head = entry.end;
+            value = entry.exp;
+            fromMemo = true;
+            return entry.exp != nullptr ? Step::ExpressionFinished : Step::ExpressionFailed;
+        }
+
+        void MemoizeExpression(Expression::Ptr exp)
+        {
+            auto & frame = frames.back();
+            bool replayed = fromMemo;
+            fromMemo = false;
+            if (!symbols.memoization || replayed || frame.frameType == FrameType::Root || frame.start == tail)
+                return;
+            auto & entry = symbols.memoTable[{ &*frame.start, StackEntry::Expression }];
+            entry.exp = exp;
+            entry.end = head;
+            entry.errors.assign(errors->begin() + frame.errorCheckpoint, errors->end());
+        }
+
+        Step StartPrimary(bool tryFunction)
+        {
+            fromMemo = false;
+            if (CheckReachTheEnd(head, tail, *errors))
+                return Step::PrimaryFailed;
+
+            auto & token = *head;
+            if (tryFunction && (token.type == CodeTokenType::Identifier || token.type == CodeTokenType::OpenBracket))
+            {
+                size_t candidateBegin = candidates.size();
+                FindCandidates();
+                if (candidates.size() != candidateBegin)
+                    return BeginFunction(candidateBegin, false);
+            }
+
+            switch (token.type)
+            {
+            case CodeTokenType::IntegerLiteral:
+            case CodeTokenType::FloatLiteral:
+            case CodeTokenType::StringLiteral:
+                {
+                    auto literalExp = symbols.arena->New<LiteralExpression>();
+                    literalExp->type =
+                        token.type == CodeTokenType::IntegerLiteral ? LiteralType::Integer :
+                        token.type == CodeTokenType::FloatLiteral ? LiteralType::Float :
+                        token.type == CodeTokenType::StringLiteral ? LiteralType::String :
+                        LiteralType::UnKnown;
+                    literalExp->value = token.value.ToString();
+                    ++head;
+                    value = literalExp;
+                    return Step::AfterPrimary;
+                }
+            case CodeTokenType::Add:
+            case CodeTokenType::Sub:
+            case CodeTokenType::Not:
+                {
+                    if (!CheckDepth())
+                        return Step::Finished;
+                    PendingOperator unaryOperator;
+                    unaryOperator.isUnary = true;
+                    unaryOperator.unaryOperator =
+                        token.type == CodeTokenType::Add ? UnaryOperator::Positive :
+                        token.type == CodeTokenType::Sub ? UnaryOperator::Negative :
+                        token.type == CodeTokenType::Not ? UnaryOperator::Not :
+                        UnaryOperator::UnKnown;
+                    unaryOperator.binaryOperator = BinaryOperator::UnKnown;
+                    unaryOperator.precedence = 0;
+                    unaryOperator.token = head;
+                    unaryOperator.errorCheckpoint = errors->size();
+                    operators.push_back(unaryOperator);
+                    ++head;
+                    return Step::Primary;
+                }
+            case CodeTokenType::OpenBracket:
+                {
+                    // (), (1,), (1,2) are valid ListExpression, (1) is the expression in brackets
+                    auto next = std::next(head);
+                    if (next != tail && next->type == CodeTokenType::CloseBracket)
+                    {
+                        head = std::next(next);
+                        value = symbols.arena->New<ListExpression>();
+                        return Step::AfterPrimary;
+                    }
+                    if (!CheckDepth())
+                        return Step::Finished;
+                    ++head;
+                    frames.push_back(NewFrame(FrameType::Bracket));
+                    return BeginExpression();
+                }
+            case CodeTokenType::Identifier:
+                {
+                    value = symbols.ParseSymbol(head, tail, *errors);
+                    return value != nullptr ? Step::AfterPrimary : Step::PrimaryFailed;
+                }
+            default:
+                // no other token starts a primary
+                break;
+            }
+            // neither a list
+            errors->push_back({
+                CompileErrorType::Parser_UnExpectedTokenType,
+                token,
+                static_cast<uint32_t>(CodeTokenType::OpenBracket)
+            });
+            return Step::PrimaryFailed;
+        }
+
+        // ParseInvokeFunction and ParseOneFunction, the primary is nothing but a function invoking
+        Step StartFunction(const FunctionDeclaration::Ptr * function)
+        {
+            if (CheckReachTheEnd(head, tail, *errors))
+                return Step::PrimaryFailed;
+            size_t candidateBegin = candidates.size();
+            if (function != nullptr)
+                candidates.push_back({ function });
+            else
+                FindCandidates();
+            if (candidates.size() == candidateBegin)
+                return Step::PrimaryFailed;
+            return BeginFunction(candidateBegin, true);
+        }
+
+        // ParseList, the primary is nothing but a list
+        Step StartList()
+        {
+            if (CheckReachTheEnd(head, tail, *errors)
+                || !CheckSingleTokenType(head, tail, CodeTokenType::OpenBracket, *errors))
+                return Step::PrimaryFailed;
+            if (!CheckDepth())
+                return Step::Finished;
+            frames.push_back(NewFrame(FrameType::Bracket));
+            auto & frame = frames.back();
+            frame.isList = true;
+            frame.reportErrors = true;
+            return BeginExpression();
+        }
+
+        // the token is not the one expected by StartList or StartFunction
+        void ReportUnexpectedToken(CodeTokenType type)
+        {
+            if (CheckReachTheEnd(head, tail, *errors))
+                return;
+            errors->push_back({
+                CompileErrorType::Parser_UnExpectedTokenType,
+                *head,
+                static_cast<uint32_t>(type)
+            });
+        }
+
+        void Reduce(int minPrecedence)
+        {
+            auto & frame = frames.back();
+            while (operators.size() > frame.operatorBase && operators.back().precedence >= minPrecedence)
+            {
+                DEBUGCHECK(!operators.back().isUnary);
+                auto binaryExp = symbols.arena->New<BinaryExpression>();
+                binaryExp->binaryOperator = operators.back().binaryOperator;
+                binaryExp->rightOperand = operands.back();
+                operands.pop_back();
+                binaryExp->leftOperand = operands.back();
+                operands.back() = binaryExp;
+                operators.pop_back();
+            }
+        }
+
+        Step FinishExpression()
+        {
+            // all the binary operators are left associative
+            Reduce(1);
+            DEBUGCHECK(operands.size() == frames.back().operandBase + 1);
+            value = operands.back();
+            operands.pop_back();
+            return Step::ExpressionFinished;
+        }
+
+        Step AfterPrimary()
+        {
+            auto & frame = frames.back();
+            // the unary operators only take the primary after them
+            auto exp = value;
+            while (operators.size() > frame.operatorBase && operators.back().isUnary)
+            {
+                auto unaryExp = symbols.arena->New<UnaryExpression>();
+                unaryExp->unaryOperator = operators.back().unaryOperator;
+                unaryExp->operand = exp;
+                exp = unaryExp;
+                operators.pop_back();
+            }
+            operands.push_back(exp);
+            if (frame.primaryOnly || head == tail)
+                return FinishExpression();
+
+            auto & info = GetBinaryOperator(head->type);
+            if (info.precedence == 0)
+                return FinishExpression();
+            Reduce(info.precedence);
+            if (!CheckDepth())
+                return Step::Finished;
+            PendingOperator binaryOperator;
+            binaryOperator.isUnary = false;
+            binaryOperator.unaryOperator = UnaryOperator::UnKnown;
+            binaryOperator.binaryOperator = info.binaryOperator;
+            binaryOperator.precedence = info.precedence;
+            binaryOperator.token = head;
+            binaryOperator.errorCheckpoint = errors->size();
+            operators.push_back(binaryOperator);
+            ++head;
+            return Step::Primary;
+        }
+
+        Step PrimaryFailed()
+        {
+            auto & frame = frames.back();
+            while (operators.size() > frame.operatorBase && operators.back().isUnary)
+                operators.pop_back();
+            if (operators.size() == frame.operatorBase)
+                return Step::ExpressionFailed;
+
+            // it's fine for the right operand not to be found, the expression ends before the operator
+            head = operators.back().token;
+            errors->resize(operators.back().errorCheckpoint);
+            operators.pop_back();
+            return FinishExpression();
+        }
+
+        Step ExpressionFinished()
+        {
+            MemoizeExpression(value);
+            auto & frame = frames.back();
+            switch (frame.frameType)
+            {
+            case FrameType::Root:
+                return Step::Finished;
+            case FrameType::Bracket:
+                if (frame.reportErrors)
+                    return ListElementFinished();
+                if (!frame.isList)
+                {
+                    if (CheckSingleTokenType(head, tail, CodeTokenType::CloseBracket))
+                    {
+                        PopFrame();
+                        return Step::AfterPrimary;
+                    }
+                    if (head == tail || head->type != CodeTokenType::Comma)
+                    {
+                        errors->push_back({
+                            CompileErrorType::Parser_CloseBracketNotFound,
+                            head != tail ? *head : *std::prev(head)
+                        });
+                        PopFrame();
+                        return Step::PrimaryFailed;
+                    }
+                    frame.isList = true;
+                    frame.firstComma = head;
+                }
+                collected.push_back(value);
+                if (CheckSingleTokenType(head, tail, CodeTokenType::Comma))
+                    return BeginExpression();
+                if (CheckSingleTokenType(head, tail, CodeTokenType::CloseBracket))
+                    return FinishList();
+                return FailList();
+            case FrameType::Function:
+                if (!CheckSingleTokenType(head, tail, CodeTokenType::CloseBracket))
+                {
+                    if (frame.reportErrors)
+                        ReportUnexpectedToken(CodeTokenType::CloseBracket);
+                    return NextCandidate();
+                }
+                collected.push_back(value);
+                frame.fragment++;
+                return AdvanceFunction();
+            }
+            ERRORMSG("invalid FrameType");
+            return Step::Finished;
+        }
+
+        Step ExpressionFailed()
+        {
+            auto & frame = frames.back();
+            operands.resize(frame.operandBase);
+            operators.resize(frame.operatorBase);
+            head = frame.start;
+            MemoizeExpression(nullptr);
+            switch (frame.frameType)
+            {
+            case FrameType::Root:
+                value = nullptr;
+                return Step::Finished;
+            case FrameType::Bracket:
+                if (frame.reportErrors)
+                    return ListElementFailed();
+                if (!frame.isList)
+                {
+                    PopFrame();
+                    return Step::PrimaryFailed;
+                }
+                // no more element is fine after the only element
+                if (collected.size() == frame.collectedBase + 1
+                    && CheckSingleTokenType(head, tail, CodeTokenType::CloseBracket))
+                {
+                    errors->resize(frame.errorCheckpoint);
+                    return FinishList();
+                }
+                return FailList();
+            case FrameType::Function:
+                return NextCandidate();
+            }
+            ERRORMSG("invalid FrameType");
+            return Step::Finished;
+        }
+
+        Step FinishList()
+        {
+            auto & frame = frames.back();
+            auto list = symbols.arena->New<ListExpression>();
+            list->elements.assign(collected.begin() + frame.collectedBase, collected.end());
+            PopFrame();
+            value = list;
+            return Step::AfterPrimary;
+        }
+
+        Step FailList()
+        {
+            // then it's not an expression in brackets either, which ends at the first comma
+            auto & frame = frames.back();
+            errors->resize(frame.errorCheckpoint);
+            errors->push_back({
+                CompileErrorType::Parser_CloseBracketNotFound,
+                *frame.firstComma
+            });
+            PopFrame();
+            return Step::PrimaryFailed;
+        }
+
+        // the errors of the elements are never kept by ParseList, but why the list ends without a close bracket
+        Step ListElementFinished()
+        {
+            auto & frame = frames.back();
+            errors->resize(frame.errorCheckpoint);
+            collected.push_back(value);
+            if (CheckSingleTokenType(head, tail, CodeTokenType::Comma))
+                return BeginExpression();
+            if (collected.size() == frame.collectedBase + 1)
+            {
+                errors->push_back({
+                    CompileErrorType::Parser_OneElementListShouldEndWithComma,
+                    head != tail ? *head : *std::prev(head)
+                });
+                PopFrame();
+                return Step::PrimaryFailed;
+            }
+            return CloseList();
+        }
+
+        Step ListElementFailed()
+        {
+            // no more element is fine after the first comma, but not after the others
+            auto & frame = frames.back();
+            errors->resize(frame.errorCheckpoint);
+            if (collected.size() >= frame.collectedBase + 2)
+            {
+                errors->push_back({
+                    CompileErrorType::Parser_NotOneElementListShouldNotEndWithComma,
+                    head != tail ? *head : *std::prev(head)
+                });
+                PopFrame();
+                return Step::PrimaryFailed;
+            }
+            return CloseList();
+        }
+
+        Step CloseList()
+        {
+            if (CheckSingleTokenType(head, tail, CodeTokenType::CloseBracket))
+                return FinishList();
+            ReportUnexpectedToken(CodeTokenType::CloseBracket);
+            PopFrame();
+            return Step::PrimaryFailed;
+        }
+
+        // the function invoking candidates of all the stack items from head, the inner scopes first
+        void FindCandidates()
+        {
+            for (size_t item = symbols.stackItems.size(); item-- > 0;)
+            {
+                auto & stackItem = symbols.stackItems[item];
+                stackItem->functionTrie.Update(stackItem->functionTables);
+                candidateIndexes.clear();
+                stackItem->functionTrie.FindCandidates(head, tail, candidateIndexes);
+                for (auto index : candidateIndexes)
+                    candidates.push_back({ &stackItem->functionTables[index] });
+            }
+        }
+
+        // try candidates[candidateBegin:] one by one
+        Step BeginFunction(size_t candidateBegin, bool reportErrors)
+        {
+            if (!CheckDepth())
+                return Step::Finished;
+            frames.push_back(NewFrame(FrameType::Function));
+            auto & frame = frames.back();
+            frame.reportErrors = reportErrors;
+            frame.functionStart = head;
+            frame.functionCheckpoint = errors->size();
+            frame.candidateBase = frame.candidate = candidateBegin;
+            frame.candidateEnd = candidates.size();
+            return AdvanceFunction();
+        }
+
+        // match the fragments of the current candidate until an argument is needed
+        Step AdvanceFunction()
+        {
+            auto & frame = frames.back();
+            while (frame.candidate != frame.candidateEnd)
+            {
+                auto & function = *candidates[frame.candidate].function;
+                auto & fragments = function->fragments;
+                for (; frame.fragment < fragments.size(); frame.fragment++)
+                {
+                    auto & fragment = fragments[frame.fragment];
+                    if (head == tail)
+                        break;
+                    if (fragment->type == FunctionFragmentType::Name)
+                    {
+                        if (head->type != CodeTokenType::Identifier || head->name != fragment->name)
+                            break;
+                        ++head;
+                    }
+                    else if (fragment->type == FunctionFragmentType::Argument)
+                    {
+                        if (head->type != CodeTokenType::OpenBracket)
+                            break;
+                        ++head;
+                        return BeginExpression();
+                    }
+                    else ERRORMSG("invalid FunctionFragmentType");
+                }
+                if (frame.fragment == fragments.size())
+                {
+                    // the errors of the failed candidates are only kept when no one matches
+                    if (frame.reportErrors)
+                        errors->resize(frame.functionCheckpoint);
+                    auto functionExp = symbols.arena->New<FunctionInvokeExpression>();
+                    functionExp->function = function;
+                    functionExp->arguments.assign(collected.begin() + frame.collectedBase, collected.end());
+                    PopFrame();
+                    value = functionExp;
+                    return Step::AfterPrimary;
+                }
+                if (frame.reportErrors)
+                    ReportMismatch(*fragments[frame.fragment]);
+                SkipCandidate();
+            }
+            head = frame.functionStart;
+            if (frame.reportErrors)
+            {
+                PopFrame();
+                return Step::PrimaryFailed;
+            }
+            // the tokens are not a function invoking, nor are the errors of the candidates kept
+            PopFrame();
+            return Step::PrimaryNotFunction;
+        }
+
+        // why the candidate fails at the fragment
+        void ReportMismatch(const FunctionFragment & fragment)
+        {
+            if (fragment.type == FunctionFragmentType::Argument || head == tail || head->type != CodeTokenType::Identifier)
+            {
+                ReportUnexpectedToken(fragment.type == FunctionFragmentType::Name
+                    ? CodeTokenType::Identifier : CodeTokenType::OpenBracket);
+                return;
+            }
+            errors->push_back({
+                CompileErrorType::Parser_WrongFunctionName,
+                *head,
+                fragment.name.Id()
+            });
+        }
+
+        void SkipCandidate()
+        {
+            auto & frame = frames.back();
+            frame.candidate++;
+            frame.fragment = 0;
+            head = frame.functionStart;
+            collected.resize(frame.collectedBase);
+            if (!frame.reportErrors)
+                errors->resize(frame.functionCheckpoint);
+        }
+
+        Step NextCandidate()
+        {
+            SkipCandidate();
+            return AdvanceFunction();
+        }
+
+        SymbolStack & symbols;
+        TokenIter head;
+        TokenIter tail;
+        CompileError::List * errors;
+        size_t rootCheckpoint;
+        Expression::Ptr value;
+        bool fromMemo = false;  // value is replayed by BeginExpression
+
+        std::vector<Frame> frames;
+        Expression::List operands;
+        std::vector<PendingOperator> operators;
+        Expression::List collected;
+        std::vector<Candidate> candidates;
+        std::vector<size_t> candidateIndexes;
+    };
+
+    Expression::Ptr SymbolStack::ParseByStack(TokenIter & head, TokenIter tail, StackEntry entry,
+        CompileError::List & errors, const FunctionDeclaration::Ptr * function)
+    {
+        // the stacks are kept for the next expression
+        if (stackParser == nullptr)
+            stackParser = std::make_shared<StackParser>(*this);
+        // the tokens may be gone after it returns, so the cache is never kept across the calls.
+        // nothing parses again from the entry, only the expressions in it are cached
+        if (memoization)
+            memoTable.clear();
+        return stackParser->Parse(head, tail, entry, errors, function);
+    }
+}
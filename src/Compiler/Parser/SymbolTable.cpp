@@ -0,0 +1,105 @@
+#include <iterator>
+
+#include "SymbolTable.h"
+#include "ExpressionParser.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    const size_t SymbolTable::EmptySlot;
+
+    SymbolTable::SymbolTable()
+        : slots(64, EmptySlot)
+    {}
+
+    void SymbolTable::PushScope()
+    {
+        undoLogs.emplace_back();
+    }
+
+    void SymbolTable::PopScope()
+    {
+        DEBUGCHECK(!undoLogs.empty());
+        size_t scope = undoLogs.size() - 1;
+        for (auto index : undoLogs.back())
+        {
+            // bindings of the innermost scope are always the last ones
+            auto & bindings = entries[index].bindings;
+            while (!bindings.empty() && bindings.back().scope == scope)
+                bindings.pop_back();
+        }
+        undoLogs.pop_back();
+    }
+
+    void SymbolTable::Add(size_t scope, const std::shared_ptr<Symbol> & symbol)
+    {
+        DEBUGCHECK(scope < undoLogs.size());
+        size_t index = FindOrAddEntry(symbol->name);
+        auto & bindings = entries[index].bindings;
+        // keep the bindings ordered by scope, before the ones of the same scope added earlier
+        auto it = bindings.end();
+        while (it != bindings.begin() && std::prev(it)->scope >= scope)
+            --it;
+        if (it == bindings.end() || it->scope != scope)
+            undoLogs[scope].push_back(index);
+        bindings.insert(it, { scope, symbol });
+    }
+
+    std::shared_ptr<Symbol> SymbolTable::Find(Name name) const
+    {
+        size_t slot = FindSlot(name);
+        if (slots[slot] == EmptySlot)
+            return nullptr;
+        auto & bindings = entries[slots[slot]].bindings;
+        return bindings.empty() ? nullptr : bindings.back().symbol;
+    }
+
+    namespace
+    {
+        // ids of names are mostly consecutive, spread them over the slots
+        size_t HashName(Name name)
+        {
+            return static_cast<size_t>(name.Id() * 2654435761u);
+        }
+    }
+
+    size_t SymbolTable::FindSlot(Name name) const
+    {
+        // linear probing, the table is never full
+        size_t mask = slots.size() - 1;
+        for (size_t slot = HashName(name) & mask; ; slot = (slot + 1) & mask)
+        {
+            size_t index = slots[slot];
+            if (index == EmptySlot || entries[index].name == name)
+                return slot;
+        }
+    }
+
+    size_t SymbolTable::FindOrAddEntry(Name name)
+    {
+        size_t slot = FindSlot(name);
+        if (slots[slot] != EmptySlot)
+            return slots[slot];
+
+        size_t index = entries.size();
+        entries.push_back({ name, {} });
+        slots[slot] = index;
+        // keep the load factor under 1/2
+        if (entries.size() * 2 > slots.size())
+            Rehash(slots.size() * 2);
+        return index;
+    }
+
+    void SymbolTable::Rehash(size_t slotCount)
+    {
+        slots.assign(slotCount, EmptySlot);
+        size_t mask = slotCount - 1;
+        for (size_t index = 0; index < entries.size(); index++)
+        {
+            size_t slot = HashName(entries[index].name) & mask;
+            while (slots[slot] != EmptySlot)
+                slot = (slot + 1) & mask;
+            slots[slot] = index;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef MINIMOE_SYMBOL_TABLE_H
+#define MINIMOE_SYMBOL_TABLE_H
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "Compiler/Name.h"
+
+namespace minimoe
+{
+    class Symbol;
+
+    // symbols of all the scopes of a SymbolStack in one open addressing hash table.
+    // each name has an entry holding the symbols of this name from the outermost scope to the innermost,
+    // and every scope keeps an undo log of the entries it added symbols to, so a scope is popped without any search
+    class SymbolTable
+    {
+    public:
+        SymbolTable();
+
+        void PushScope();
+        void PopScope();
+        size_t ScopeCount() const { return undoLogs.size(); }
+
+        // symbols in inner scopes shadow the outer ones, in the same scope the first added one wins
+        void Add(size_t scope, const std::shared_ptr<Symbol> & symbol);
+        std::shared_ptr<Symbol> Find(Name name) const;
+
+    private:
+        static const size_t EmptySlot = static_cast<size_t>(-1);
+
+        struct Binding
+        {
+            size_t scope;
+            std::shared_ptr<Symbol> symbol;
+        };
+
+        struct Entry
+        {
+            Name name;
+            std::vector<Binding> bindings; // the innermost is the last one
+        };
+
+        size_t FindSlot(Name name) const;
+        size_t FindOrAddEntry(Name name);
+        void Rehash(size_t slotCount);
+
+        std::vector<size_t> slots; // index of entries, the size is a power of 2
+        std::vector<Entry> entries; // entries are never removed
+        std::vector<std::vector<size_t>> undoLogs;
+    };
+}
+
+#endif
@@ -1,8 +1,6 @@
 #ifndef MINIMOE_UTILS_PARSER_H
 #define MINIMOE_UTILS_PARSER_H
 
-#include <functional>
-
 #include "Compiler/Lexer/Lexer.h"
 
 namespace minimoe
@@ -16,9 +14,45 @@ namespace minimoe
     // for lines
     bool CheckEndOfFile(LineIter head, LineIter tail, CompileError::List & errors);
 
-    typedef std::function<bool(TokenIter & head, TokenIter tail)> ParseLineFunc;
-    typedef std::function<bool(ParseLineFunc&)> ParseLineHelper;
-    ParseLineHelper GenParseLineHelper(LineIter & head, LineIter tail, CompileError::List & errors);
+    // parse the line at head by parseLine(TokenIter & tokenIt, TokenIter tokenEnd) returning bool,
+    // then check nothing is left in the line and go to the next one.
+    // parseLine is a template argument, so it's called directly instead of through std::function
+    class ParseLineHelper
+    {
+    public:
+        ParseLineHelper(LineIter & _head, LineIter _tail, CompileError::List & _errors)
+            : head(_head), tail(_tail), errors(_errors)
+        {}
+
+        template<class ParseLineFunc>
+        bool operator()(ParseLineFunc && parseLine)
+        {
+            if (CheckEndOfFile(head, tail, errors))
+                return false;
+            auto tokenIt = head->begin();
+            auto tokenEnd = head->end();
+            if (CheckReachTheEnd(tokenIt, tokenEnd, errors))
+                return false;
+
+            if (!parseLine(tokenIt, tokenEnd))
+                return false;
+
+            // just check and give errors message, go on even if error was raised
+            CheckParseToLineEnd(tokenIt, tokenEnd, errors);
+            ++head;
+            return true;
+        }
+
+    private:
+        LineIter & head;
+        LineIter tail;
+        CompileError::List & errors;
+    };
+
+    inline ParseLineHelper GenParseLineHelper(LineIter & head, LineIter tail, CompileError::List & errors)
+    {
+        return ParseLineHelper(head, tail, errors);
+    }
 }
 
 #endif
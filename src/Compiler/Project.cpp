@@ -0,0 +1,428 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <algorithm>
+
+#include "Project.h"
+#include "Compiler/Parser/FunctionBody.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    using std::string;
+
+    namespace
+    {
+        typedef std::chrono::steady_clock Clock;
+        typedef std::unordered_map<Name, size_t, NameHash> UnitIndexMap;
+
+        double MillisecondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // an error at location about the module name
+        CompileError MakeModuleError(CompileErrorType errorType, SourceLocation location, Name name)
+        {
+            CodeToken token(location, name.View(), CodeTokenType::Identifier);
+            token.name = name;
+            return{ errorType, token, name.Id() };
+        }
+
+        /*******************
+        Parse
+        ********************/
+        void LexAndParse(ModuleUnit & unit, bool makeInterface)
+        {
+            auto lexStart = Clock::now();
+            unit.codeFile = unit.inMemory ? CodeFile::Parse(std::move(unit.code)) : CodeFile::Parse(unit.file);
+            unit.lexTime = MillisecondsSince(lexStart);
+            unit.errors = unit.codeFile->errors;
+
+            auto parseStart = Clock::now();
+            unit.module = Module::Parse(unit.codeFile, unit.errors);
+            if (makeInterface)
+                unit.moduleInterface = ModuleInterface::Make(unit.module, unit.sourceHash);
+            unit.fromCache = false;
+            unit.parseTime = MillisecondsSince(parseStart);
+        }
+
+        string InterfacePath(const string & cacheDirectory, const string & path)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.moei", static_cast<unsigned long long>(HashBytes(path.data(), path.size())));
+            return cacheDirectory + "/" + name;
+        }
+
+        // the interface in the cache is used if it's saved from the same source
+        void LoadAndParse(ModuleUnit & unit, const string & cacheDirectory)
+        {
+            auto loadStart = Clock::now();
+            if (!unit.inMemory)
+            {
+                unit.file = MappedFile::Open(unit.path, unit.loadError);
+                if (!unit.file)
+                    return;
+            }
+            if (!cacheDirectory.empty())
+            {
+                unit.sourceHash = unit.inMemory ? HashBytes(unit.code.data(), unit.code.size()) : HashBytes(unit.file->data(), unit.file->size());
+                unit.interfacePath = InterfacePath(cacheDirectory, unit.path);
+                auto cached = ModuleInterface::Load(unit.interfacePath);
+                if (cached != nullptr && cached->sourceHash == unit.sourceHash)
+                {
+                    unit.moduleInterface = cached;
+                    unit.module = cached->module;
+                    unit.fromCache = true;
+                }
+            }
+            unit.loadTime = MillisecondsSince(loadStart);
+            if (!unit.fromCache)
+                LexAndParse(unit, !cacheDirectory.empty());
+        }
+
+        // the first unit of each module name
+        UnitIndexMap IndexModules(const ModuleUnit::List & units)
+        {
+            UnitIndexMap unitIndexes;
+            for (size_t i = 0; i < units.size(); i++)
+            {
+                auto & module = units[i]->module;
+                if (module != nullptr && !module->name.empty())
+                    unitIndexes.insert({ module->name, i });
+            }
+            return unitIndexes;
+        }
+
+        // if the declarations of the modules the unit uses are the same as when its interface was saved
+        bool UsingsUnchanged(const ModuleUnit & unit, const ModuleUnit::List & units,
+            const UnitIndexMap & unitIndexes)
+        {
+            auto & usings = unit.module->usings;
+            auto & usingHashes = unit.moduleInterface->usingHashes;
+            if (usings.size() != usingHashes.size())
+                return false;
+            for (size_t i = 0; i < usings.size(); i++)
+            {
+                auto found = unitIndexes.find(static_cast<UsingDeclaration*>(usings[i].get())->moduleName);
+                if (found == unitIndexes.end())
+                    return false;
+                auto & usedInterface = units[found->second]->moduleInterface;
+                if (usedInterface == nullptr || usedInterface->declarationHash != usingHashes[i])
+                    return false;
+            }
+            return true;
+        }
+
+        void ResolveUsings(ModuleUnit::List & units, const UnitIndexMap & unitIndexes)
+        {
+            for (size_t i = 0; i < units.size(); i++)
+            {
+                auto & unit = *units[i];
+                if (unit.module == nullptr || unit.module->name.empty() || unitIndexes.at(unit.module->name) == i)
+                    continue;
+                // the first one is used
+                auto location = unit.codeFile == nullptr || unit.codeFile->tokens.empty()
+                    ? SourceLocation() : unit.codeFile->tokens.front().location;
+                unit.errors.push_back(MakeModuleError(CompileErrorType::Project_DuplicateModule, location, unit.module->name));
+            }
+
+            for (size_t i = 0; i < units.size(); i++)
+            {
+                auto & unit = *units[i];
+                if (unit.module == nullptr)
+                    continue;
+                for (auto & declaration : unit.module->usings)
+                {
+                    auto usi = static_cast<UsingDeclaration*>(declaration.get());
+                    auto found = unitIndexes.find(usi->moduleName);
+                    if (found == unitIndexes.end())
+                    {
+                        unit.errors.push_back(MakeModuleError(CompileErrorType::Project_ModuleNotFound,
+                            usi->location, usi->moduleName));
+                        continue;
+                    }
+                    unit.dependencies.push_back({ found->second, usi });
+                    units[found->second]->dependents.push_back(i);
+                }
+            }
+        }
+
+        // depth first search without recursion, a using to a unit still on the path closes a cycle.
+        // return the units in a cycle or using one, which can't be compiled
+        std::vector<bool> FindCycles(ModuleUnit::List & units)
+        {
+            enum class Visit { NotVisited, OnPath, Finished };
+            struct Frame
+            {
+                size_t unit;
+                size_t next;    // the dependency to visit next
+            };
+
+            std::vector<Visit> visits(units.size(), Visit::NotVisited);
+            std::vector<bool> blocked(units.size(), false);
+            std::vector<Frame> path;
+            for (size_t root = 0; root < units.size(); root++)
+            {
+                if (visits[root] != Visit::NotVisited)
+                    continue;
+                visits[root] = Visit::OnPath;
+                path.push_back({ root, 0 });
+                while (!path.empty())
+                {
+                    auto & frame = path.back();
+                    auto & dependencies = units[frame.unit]->dependencies;
+                    if (frame.next == dependencies.size())
+                    {
+                        // the dependencies are all finished
+                        for (auto & dependency : dependencies)
+                            blocked[frame.unit] = blocked[frame.unit] || blocked[dependency.unit];
+                        visits[frame.unit] = Visit::Finished;
+                        path.pop_back();
+                        continue;
+                    }
+
+                    auto & dependency = dependencies[frame.next++];
+                    if (visits[dependency.unit] == Visit::NotVisited)
+                    {
+                        visits[dependency.unit] = Visit::OnPath;
+                        path.push_back({ dependency.unit, 0 });
+                    }
+                    else if (visits[dependency.unit] == Visit::OnPath)
+                    {
+                        // the cycle is from dependency.unit along the path back to it, report every using of it
+                        auto first = std::find_if(path.begin(), path.end(),
+                            [&](const Frame & f){ return f.unit == dependency.unit; });
+                        for (auto it = first; it != path.end(); ++it)
+                        {
+                            auto usi = units[it->unit]->dependencies[it->next - 1].declaration;
+                            units[it->unit]->errors.push_back(MakeModuleError(CompileErrorType::Project_CyclicUsing,
+                                usi->location, usi->moduleName));
+                            blocked[it->unit] = true;
+                        }
+                    }
+                }
+            }
+            return blocked;
+        }
+
+        /*******************
+        Compile
+        ********************/
+        // parse the function bodies with the types and functions of the module and the modules it uses,
+        // then save the interface if it's cached
+        void Compile(ModuleUnit & unit, const ModuleUnit::List & units)
+        {
+            if (unit.fromCache)
+                return;
+            auto compileStart = Clock::now();
+            auto item = std::make_shared<SymbolStackItem>();
+            item->LoadPredefinedSymbol();
+            std::vector<Module*> visibleModules(1, unit.module.get());
+            for (auto & dependency : unit.dependencies)
+            {
+                auto module = units[dependency.unit]->module.get();
+                if (std::find(visibleModules.begin(), visibleModules.end(), module) == visibleModules.end())
+                    visibleModules.push_back(module);
+            }
+            for (auto module : visibleModules)
+            {
+                for (auto & declaration : module->types)
+                {
+                    auto type = std::static_pointer_cast<TypeDeclaration>(declaration);
+                    item->addSymbol(type, type->name);
+                }
+                item->functionTables.insert(item->functionTables.end(), module->functions.begin(), module->functions.end());
+            }
+
+            SymbolStack stack;
+            stack.arena = unit.module->arena;
+            stack.Push(item);
+            for (auto & function : unit.module->functions)
+            {
+                auto body = MaterializeBody(function, stack);
+                unit.errors.insert(unit.errors.end(), body->errors.begin(), body->errors.end());
+            }
+            stack.Pop();
+
+            if (unit.moduleInterface != nullptr && unit.errors.empty())
+            {
+                // all the usings are resolved without errors
+                unit.moduleInterface->usingHashes.clear();
+                for (auto & dependency : unit.dependencies)
+                    unit.moduleInterface->usingHashes.push_back(units[dependency.unit]->moduleInterface->declarationHash);
+                // the cache only saves time, the build is fine without it
+                string errorMsg;
+                unit.moduleInterface->Save(unit.interfacePath, errorMsg);
+            }
+            unit.compileTime = MillisecondsSince(compileStart);
+        }
+
+        // starts a unit when the units it uses are all finished
+        class CompileScheduler
+        {
+        public:
+            CompileScheduler(ModuleUnit::List & _units, const std::vector<bool> & _blocked,
+                ThreadPool & _pool, Clock::time_point _buildStart)
+                : units(_units), blocked(_blocked), pool(_pool), buildStart(_buildStart),
+                waitingCount(_units.size(), 0)
+            {}
+
+            // return the units in the order they are finished
+            std::vector<size_t> Run()
+            {
+                std::vector<size_t> ready;
+                for (size_t i = 0; i < units.size(); i++)
+                {
+                    if (blocked[i])
+                        continue;
+                    remaining++;
+                    waitingCount[i] = units[i]->dependencies.size();
+                    if (waitingCount[i] == 0)
+                        ready.push_back(i);
+                }
+                for (auto i : ready)
+                    Start(i);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                allFinished.wait(lock, [this](){ return remaining == 0; });
+                return finishOrder;
+            }
+
+        private:
+            void Start(size_t i)
+            {
+                pool.Submit([this, i](){ CompileAndRelease(i); });
+            }
+
+            void CompileAndRelease(size_t i)
+            {
+                Compile(*units[i], units);
+                units[i]->finishTime = MillisecondsSince(buildStart);
+
+                std::vector<size_t> ready;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finishOrder.push_back(i);
+                    for (auto dependent : units[i]->dependents)
+                    {
+                        if (!blocked[dependent] && --waitingCount[dependent] == 0)
+                            ready.push_back(dependent);
+                    }
+                    // notified with the lock, Run may return and destroy the scheduler as soon as it's released
+                    if (--remaining == 0)
+                        allFinished.notify_all();
+                }
+                for (auto dependent : ready)
+                    Start(dependent);
+            }
+
+            ModuleUnit::List & units;
+            const std::vector<bool> & blocked;
+            ThreadPool & pool;
+            Clock::time_point buildStart;
+
+            std::mutex mutex;
+            std::condition_variable allFinished;
+            std::vector<size_t> waitingCount;   // the dependencies not finished yet
+            std::vector<size_t> finishOrder;
+            size_t remaining = 0;
+        };
+    }
+
+    ModuleUnit::Ptr Project::AddFile(const string & path)
+    {
+        auto unit = std::make_shared<ModuleUnit>();
+        unit->path = path;
+        units.push_back(unit);
+        return unit;
+    }
+
+    ModuleUnit::Ptr Project::AddSource(const string & path, string code)
+    {
+        auto unit = std::make_shared<ModuleUnit>();
+        unit->path = path;
+        unit->inMemory = true;
+        unit->code = std::move(code);
+        units.push_back(unit);
+        return unit;
+    }
+
+    bool Project::Build(ThreadPool & pool)
+    {
+        auto buildStart = Clock::now();
+
+        // the usings are unknown until parsed, so all the units are parsed at the same time
+        std::vector<std::future<void>> parsed;
+        for (auto & unit : units)
+        {
+            auto u = unit.get();
+            auto & directory = cacheDirectory;
+            parsed.push_back(pool.Submit([u, &directory](){ LoadAndParse(*u, directory); }));
+        }
+        for (auto & future : parsed)
+            future.get();
+
+        // a unit from the cache is parsed and compiled again when the declarations it uses are changed,
+        // its own declarations are still the same, so the units using it are not affected
+        // all the stale units are found before any of them is parsed again, for parsing replaces the interface of it
+        auto unitIndexes = IndexModules(units);
+        std::vector<ModuleUnit*> staleUnits;
+        for (auto & unit : units)
+        {
+            if (unit->fromCache && !UsingsUnchanged(*unit, units, unitIndexes))
+                staleUnits.push_back(unit.get());
+        }
+        parsed.clear();
+        for (auto u : staleUnits)
+            parsed.push_back(pool.Submit([u](){ LexAndParse(*u, true); }));
+        for (auto & future : parsed)
+            future.get();
+
+        ResolveUsings(units, unitIndexes);
+        auto blocked = FindCycles(units);
+        // nothing to compile for the files which can't be loaded
+        for (size_t i = 0; i < units.size(); i++)
+            blocked[i] = blocked[i] || units[i]->module == nullptr;
+        auto finishOrder = CompileScheduler(units, blocked, pool, buildStart).Run();
+        wallTime = MillisecondsSince(buildStart);
+
+        // the longest chain ending at each unit, the dependencies are always finished before it
+        std::vector<double> chainTimes(units.size(), 0);
+        std::vector<size_t> previous(units.size(), units.size());
+        criticalPath.clear();
+        criticalPathTime = 0;
+        size_t last = units.size();
+        for (auto i : finishOrder)
+        {
+            for (auto & dependency : units[i]->dependencies)
+            {
+                if (chainTimes[dependency.unit] > chainTimes[i])
+                {
+                    chainTimes[i] = chainTimes[dependency.unit];
+                    previous[i] = dependency.unit;
+                }
+            }
+            chainTimes[i] += units[i]->compileTime;
+            if (last == units.size() || chainTimes[i] > chainTimes[last])
+                last = i;
+        }
+        for (auto i = last; i != units.size(); i = previous[i])
+            criticalPath.push_back(i);
+        std::reverse(criticalPath.begin(), criticalPath.end());
+        if (last != units.size())
+            criticalPathTime = chainTimes[last];
+
+        workTime = 0;
+        bool succeeded = true;
+        for (auto & unit : units)
+        {
+            workTime += unit->loadTime + unit->lexTime + unit->parseTime + unit->compileTime;
+            succeeded = succeeded && unit->Succeeded();
+        }
+        return succeeded;
+    }
+}
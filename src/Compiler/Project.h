@@ -0,0 +1,89 @@
+#ifndef MINIMOE_PROJECT_H
+#define MINIMOE_PROJECT_H
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "Compiler/Parser/DeclarationParser.h"
+#include "Compiler/ModuleInterface.h"
+#include "Utils/MappedFile.h"
+
+namespace minimoe
+{
+    class ThreadPool;
+
+    // a source file of a project and everything compiled from it
+    class ModuleUnit
+    {
+    public:
+        typedef std::shared_ptr<ModuleUnit> Ptr;
+        typedef std::vector<Ptr> List;
+
+        struct Dependency
+        {
+            size_t unit;                    // index in Project::units
+            UsingDeclaration * declaration; // the using which depends on it
+        };
+
+        std::string path;
+        bool inMemory = false;              // added by AddSource
+        std::string code;                   // the code of AddSource, moved to codeFile when lexed
+        MappedFile::Ptr file;
+        CodeFile::Ptr codeFile;
+        Module::Ptr module;
+        std::vector<Dependency> dependencies;
+        std::vector<size_t> dependents;
+        std::string loadError;              // the file can't be loaded if not empty
+        // only used when the project has a cacheDirectory
+        uint64_t sourceHash = 0;
+        std::string interfacePath;
+        ModuleInterface::Ptr moduleInterface;
+        // the module is loaded from interfacePath, the source is not parsed and the unit is not compiled
+        bool fromCache = false;
+        // lexer, parser and using errors of the module, and the errors of its function bodies
+        CompileError::List errors;
+
+        // milliseconds, loading includes the interface from the cache
+        double loadTime = 0;
+        double lexTime = 0;
+        double parseTime = 0;
+        double compileTime = 0;
+        double finishTime = 0;              // since the start of Build
+
+        bool Succeeded() const { return loadError.empty() && errors.empty(); }
+    };
+
+    // modules depending on each other by using.
+    // Build lexes and parses all the units together, for the usings are only known after parsing.
+    // then the units are compiled in the order of the using graph: a unit is started as soon as
+    // all the units it uses are finished, so independent chains run on the workers at the same time
+    // and the build takes about as long as the longest chain when there are enough workers
+    class Project
+    {
+    public:
+        typedef std::shared_ptr<Project> Ptr;
+
+        ModuleUnit::List units;
+        // an existing directory to keep the interfaces of the modules in, nothing is cached if empty.
+        // a unit whose source and used declarations are unchanged since its interface was saved is loaded from it
+        std::string cacheDirectory;
+
+        // the longest chain of units by compileTime, each one uses the one before it
+        std::vector<size_t> criticalPath;
+        double criticalPathTime = 0;
+        // the sum of all the load, lex, parse and compile time, and the time of the whole Build
+        double workTime = 0;
+        double wallTime = 0;
+
+        ModuleUnit::Ptr AddFile(const std::string & path);
+        // code that is already in memory, path is only for reporting
+        ModuleUnit::Ptr AddSource(const std::string & path, std::string code);
+
+        // return false if any unit can't be loaded or has errors.
+        // the units in a cycle of using are not compiled, nor the units using them
+        bool Build(ThreadPool & pool);
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "Compiler/SourceLocation.h"
+#include "Compiler/Lexer/CharScanner.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    SourceManager & SourceManager::Instance()
+    {
+        // never destroyed, the CodeFiles in static storage still remove their texts after main returns
+        static SourceManager * manager = new SourceManager();
+        return *manager;
+    }
+
+    SourceManager::SourceManager()
+        : nextBase(1)
+    {}
+
+    SourceLocation SourceManager::AddSource(const char * begin, size_t size, size_t firstRow)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // one more offset for the end of the text, so that a location at the end still belongs to it
+        if (size < std::numeric_limits<uint32_t>::max() - nextBase)
+        {
+            Source source = { nextBase, static_cast<uint32_t>(size), begin, firstRow, {}, false, false };
+            sources.push_back(source);
+            nextBase += static_cast<uint32_t>(size) + 1;
+            return SourceLocation(source.base);
+        }
+
+        size_t index = ReuseRemovedSources(size);
+        if (index == sources.size() && size >= std::numeric_limits<uint32_t>::max() - nextBase)
+        {
+            // the locations would overlap, nothing could be resolved right after that
+            ERRORMSG("source offsets are used up");
+            std::abort();
+        }
+        uint32_t base = index == 0 ? 1 : sources[index - 1].base + sources[index - 1].size + 1;
+        Source source = { base, static_cast<uint32_t>(size), begin, firstRow, {}, false, false };
+        sources.insert(sources.begin() + index, source);
+        if (index + 1 == sources.size())
+            nextBase = base + static_cast<uint32_t>(size) + 1;
+        return SourceLocation(base);
+    }
+
+    size_t SourceManager::ReuseRemovedSources(size_t size)
+    {
+        sources.erase(std::remove_if(sources.begin(), sources.end(),
+            [](const Source & source){ return source.removed; }), sources.end());
+        nextBase = sources.empty() ? 1 : sources.back().base + sources.back().size + 1;
+
+        // the first gap between the texts which is large enough
+        uint64_t gapBegin = 1;
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            if (size < sources[i].base - gapBegin)
+                return i;
+            gapBegin = static_cast<uint64_t>(sources[i].base) + sources[i].size + 1;
+        }
+        return sources.size();
+    }
+
+    void SourceManager::RemoveSource(SourceLocation base)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto source = FindSource(base);
+        if (source == nullptr || source->base != base.offset)
+        {
+            ERRORMSG("removing a source which is not added");
+            return;
+        }
+        source->removed = true;
+        source->begin = nullptr;
+        std::vector<uint32_t>().swap(source->lineStarts);
+    }
+
+    SourcePosition SourceManager::Resolve(SourceLocation location)
+    {
+        SourcePosition position = { 0, 0 };
+        if (!location.IsValid())
+            return position;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto source = FindSource(location);
+        if (source == nullptr || source->removed)
+            return position;
+
+        if (!source->lineStartsFound)
+        {
+            const CharScanner & scanner = GetCharScanner();
+            const char * end = source->begin + source->size;
+            for (auto it = scanner.FindLineEnd(source->begin, end); it != end; it = scanner.FindLineEnd(it + 1, end))
+                source->lineStarts.push_back(static_cast<uint32_t>(it + 1 - source->begin));
+            source->lineStartsFound = true;
+        }
+
+        uint32_t offset = location.offset - source->base;
+        auto nextLine = std::upper_bound(source->lineStarts.begin(), source->lineStarts.end(), offset);
+        size_t line = nextLine - source->lineStarts.begin();
+        uint32_t lineStart = line == 0 ? 0 : source->lineStarts[line - 1];
+        position.row = source->firstRow + line;
+        position.column = offset - lineStart + 1;
+        return position;
+    }
+
+    SourceManager::Source * SourceManager::FindSource(SourceLocation location)
+    {
+        auto it = std::upper_bound(sources.begin(), sources.end(), location.offset,
+            [](uint32_t offset, const Source & source){ return offset < source.base; });
+        if (it == sources.begin())
+            return nullptr;
+        --it;
+        if (location.offset - it->base > it->size)
+            return nullptr;
+        return &*it;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef MINIMOE_SOURCE_LOCATION_H
+#define MINIMOE_SOURCE_LOCATION_H
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+namespace minimoe
+{
+    // a char of all the source text, every text added to the SourceManager takes a range of offsets
+    // after the ones added before it, offset 0 is not used by any text.
+    // only when the offsets after the last text are used up, the ranges of the removed texts are taken again
+    struct SourceLocation
+    {
+        uint32_t offset;
+
+        SourceLocation()
+            : offset(0)
+        {}
+        explicit SourceLocation(uint32_t _offset)
+            : offset(_offset)
+        {}
+
+        bool IsValid() const { return offset != 0; }
+        SourceLocation operator+(size_t distance) const { return SourceLocation(offset + static_cast<uint32_t>(distance)); }
+        bool operator==(SourceLocation other) const { return offset == other.offset; }
+        bool operator!=(SourceLocation other) const { return offset != other.offset; }
+    };
+
+    struct SourcePosition
+    {
+        size_t row;     // 0 if the location is invalid or its text was removed
+        size_t column;
+    };
+
+    // maps SourceLocation to row and column, the line starts of a text are only found when they are asked for
+    class SourceManager
+    {
+    public:
+        static SourceManager & Instance();
+
+        // the text should be kept alive until RemoveSource, return the location of its first char.
+        // firstRow is the row of the first char, for the text lexed piece by piece.
+        // the program is aborted if there is no range left for the text even after reusing the removed ones
+        SourceLocation AddSource(const char * begin, size_t size, size_t firstRow = 1);
+        // the locations of the text resolve to row 0 until its offsets are reused by AddSource
+        void RemoveSource(SourceLocation base);
+        SourcePosition Resolve(SourceLocation location);
+
+    private:
+        struct Source
+        {
+            uint32_t base;
+            uint32_t size;
+            const char * begin;     // may be nullptr for an empty text
+            size_t firstRow;
+            std::vector<uint32_t> lineStarts;   // offsets of the lines after the first one
+            bool lineStartsFound;
+            bool removed;
+        };
+
+        SourceManager();
+        Source * FindSource(SourceLocation location);
+        // drop the removed texts, return the index in sources to insert a text of size at, or sources.size() if not found
+        size_t ReuseRemovedSources(size_t size);
+
+        std::mutex mutex;
+        std::vector<Source> sources;    // sorted by base
+        uint32_t nextBase;
+    };
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <string>
+
+#include "Compiler/Project.h"
+#include "Utils/ThreadPool.h"
+
+using std::string;
+using namespace minimoe;
+
+namespace
+{
+    void ReportUnit(const ModuleUnit & unit)
+    {
+        if (!unit.loadError.empty())
+        {
+            std::cerr << unit.loadError << std::endl;
+            return;
+        }
+        // a unit from the cache may still have errors of the project, such as a duplicated module
+        for (auto & error : unit.errors)
+        {
+            std::cerr << unit.path << "(" << error.token.Row() << ", " << error.token.Column() << "): "
+                << error.Message() << std::endl;
+        }
+        if (unit.fromCache)
+        {
+            std::cout << unit.path << ": loaded from " << unit.interfacePath << std::endl
+                << "    load : " << unit.loadTime << " ms" << std::endl;
+            return;
+        }
+        std::cout << unit.path << ": " << unit.file->size() << " bytes, "
+            << unit.codeFile->lines.size() << " lines, " << unit.codeFile->tokens.size() << " tokens" << std::endl
+            << "    load : " << unit.loadTime << " ms" << std::endl
+            << "    lex : " << unit.lexTime << " ms" << std::endl
+            << "    parse : " << unit.parseTime << " ms" << std::endl
+            << "    compile : " << unit.compileTime << " ms, finished at " << unit.finishTime << " ms" << std::endl;
+    }
+
+    void ReportCriticalPath(const Project & project)
+    {
+        std::cout << "critical path : " << project.criticalPathTime << " ms" << std::endl;
+        for (auto i : project.criticalPath)
+            std::cout << "    " << project.units[i]->module->name.ToString() << std::endl;
+        std::cout << "work : " << project.workTime << " ms" << std::endl
+            << "wall : " << project.wallTime << " ms" << std::endl;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " [--cache <directory>] <file.moe>..." << std::endl;
+        return 1;
+    }
+    Project project;
+    for (int i = 1; i < argc; i++)
+    {
+        if (string(argv[i]) == "--cache" && i + 1 < argc)
+            project.cacheDirectory = argv[++i];
+        else
+            project.AddFile(argv[i]);
+    }
+
+    ThreadPool pool;
+    bool success = project.Build(pool);
+    for (auto & unit : project.units)
+        ReportUnit(*unit);
+    ReportCriticalPath(project);
+    return success ? 0 : 1;
+}
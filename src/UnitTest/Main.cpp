@@ -1,11 +1,13 @@
 extern void InvokeLexerTest();
 extern void InvokeExpressionParserTest();
 extern void InvokeDeclarationParserTest();
+extern void InvokeProjectTest();
 
 int main()
 {
     InvokeLexerTest();
     InvokeExpressionParserTest();
     InvokeDeclarationParserTest();
+    InvokeProjectTest();
     return 0;
 }
@@ -1,8 +1,13 @@
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <atomic>
+#include <thread>
 
 #include "Test.h"
 #include "Compiler\Parser\DeclarationParser.h"
+#include "Compiler\Parser\FunctionBody.h"
+#include "Utils\ThreadPool.h"
 
 using std::string;
 using namespace minimoe;
@@ -86,7 +91,7 @@ void TestType()
         TEST_ASSERT(type->ToLog() == "Type(MyType3, mem1)");
         TEST_ASSERT(errors.size() == 1);
         TEST_ASSERT(errors.front().errorType == CompileErrorType::Parser_CanNotParseLeftToken);
-        TEST_ASSERT(errors.front().token->row == 1);
+        TEST_ASSERT(errors.front().token.Row() == 1);
     }
     {
         string code =
@@ -110,7 +115,7 @@ void TestArgument()
         auto codeFile = CodeFile::Parse(code);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(codeFile->lines.size() == 1);
-        auto tokens = codeFile->lines.front()->tokens;
+        auto tokens = codeFile->lines.front();
         auto arg = ArgumentDeclaration::Parse(tokens.begin(), tokens.end(), errors);
         TEST_ASSERT(arg != nullptr);
         TEST_ASSERT(errors.empty());
@@ -122,7 +127,7 @@ void TestArgument()
         auto codeFile = CodeFile::Parse(code);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(codeFile->lines.size() == 1);
-        auto tokens = codeFile->lines.front()->tokens;
+        auto tokens = codeFile->lines.front();
         auto arg = ArgumentDeclaration::Parse(tokens.begin(), tokens.end(), errors);
         TEST_ASSERT(arg != nullptr);
         TEST_ASSERT(errors.empty());
@@ -134,7 +139,7 @@ void TestArgument()
         auto codeFile = CodeFile::Parse(code);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(codeFile->lines.size() == 1);
-        auto tokens = codeFile->lines.front()->tokens;
+        auto tokens = codeFile->lines.front();
         auto arg = ArgumentDeclaration::Parse(tokens.begin(), tokens.end(), errors);
         TEST_ASSERT(arg == nullptr);
         TEST_ASSERT(errors.size() == 1);
@@ -262,7 +267,208 @@ void TestModule()
         TEST_ASSERT(module->types.front()->ToLog() == "Type(mytype)");
         TEST_ASSERT(module->functions.size() == 1);
         TEST_ASSERT(module->functions.front()->ToLog() == "Sentence:print(message){1}");
+        TEST_ASSERT(SourceManager::Instance().Resolve(module->functions.front()->location).row == 9);
+        TEST_ASSERT(SourceManager::Instance().Resolve(module->types.front()->location).row == 6);
+
+        // a small buffer so that declarations cross the chunks
+        std::istringstream input(code);
+        CodeLineStream stream(input, 7);
+        auto streamedModule = Module::Parse(stream, errors);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(stream.errors.empty());
+        TEST_ASSERT(streamedModule->name == "doyoubi");
+        TEST_ASSERT(streamedModule->usings.size() == 2);
+        TEST_ASSERT(streamedModule->usings[1]->ToLog() == "Using(math)");
+        TEST_ASSERT(streamedModule->tags.size() == 1);
+        TEST_ASSERT(streamedModule->types.size() == 1);
+        TEST_ASSERT(streamedModule->types.front()->ToLog() == "Type(mytype)");
+        TEST_ASSERT(streamedModule->functions.size() == 1);
+        TEST_ASSERT(streamedModule->functions.front()->ToLog() == "Sentence:print(message){1}");
+        TEST_ASSERT(streamedModule->functions.front()->startIter->front().Row() == 10);
+    }
+    {
+        // the errors keep the chunks of their tokens even if nothing is declared by the lines
+        string code = "module doyoubi\n";
+        for (size_t i = 0; i < 200; i++)
+            code += "using std" + std::to_string(i) + "\n";
+        code += "type\n";
+        for (size_t i = 0; i < 200; i++)
+            code += "tag mytag" + std::to_string(i) + "\n";
+
+        auto codeFile = CodeFile::Parse(code);
+        CompileError::List errors;
+        Module::Parse(codeFile, errors);
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.front().token.Row() == 202);
+
+        std::istringstream input(code);
+        CodeLineStream stream(input, 64);
+        CompileError::List streamedErrors;
+        auto streamedModule = Module::Parse(stream, streamedErrors);
+        TEST_ASSERT(streamedModule->tags.size() == 200);
+        TEST_ASSERT(streamedErrors.size() == 1);
+        TEST_ASSERT(streamedErrors.front().errorType == errors.front().errorType);
+        TEST_ASSERT(streamedErrors.front().token.Row() == 202);
+        TEST_ASSERT(streamedErrors.front().token.value == "type");
+        TEST_ASSERT(streamedErrors.front().Message() == errors.front().Message());
+    }
+}
+
+void TestDeclarationIndex()
+{
+    string code =
+        "module doyoubi\n"
+        "type mytype\n"
+        "    member\n"
+        "end\n"
+        "phrase Sum(x)\n"
+        "    result = x\n"
+        "end\n"
+        "tag mytag\n";
+    auto codeFile = CodeFile::Parse(code);
+    auto lines = codeFile->lines.begin();
+    auto ranges = IndexDeclarations(codeFile->lines.begin(), codeFile->lines.end());
+    TEST_ASSERT(ranges.size() == 4);
+    TEST_ASSERT(ranges[0].kind == CodeTokenType::Module);
+    TEST_ASSERT(ranges[0].first == lines && ranges[0].last == lines + 1);
+    TEST_ASSERT(ranges[0].endLine == ranges[0].last);
+    TEST_ASSERT(ranges[1].kind == CodeTokenType::Type);
+    TEST_ASSERT(ranges[1].last == lines + 4 && ranges[1].endLine == lines + 3);
+    TEST_ASSERT(ranges[2].kind == CodeTokenType::Phrase);
+    TEST_ASSERT(ranges[2].first == lines + 4 && ranges[2].endLine == lines + 6);
+    TEST_ASSERT(ranges[3].kind == CodeTokenType::Tag);
+    TEST_ASSERT(ranges[3].last == codeFile->lines.end());
+
+    CompileError::List errors;
+    auto func = FunctionDeclaration::Parse(ranges[2], errors);
+    TEST_ASSERT(func != nullptr);
+    TEST_ASSERT(errors.empty());
+    TEST_ASSERT(func->startIter == lines + 5 && func->endIter == lines + 6);
+
+    // the lines belonging to no declaration
+    {
+        auto junkFile = CodeFile::Parse("x = 1\ntag a\nend\n");
+        auto module = Module::Parse(junkFile, errors);
+        TEST_ASSERT(module->tags.size() == 1);
+        TEST_ASSERT(errors.size() == 2);
+        TEST_ASSERT(errors[0].errorType == CompileErrorType::Parser_CanNotParseLeftToken);
+        TEST_ASSERT(errors[0].token.Row() == 1);
+        TEST_ASSERT(errors[1].errorType == CompileErrorType::Parser_CanNotParseLeftToken);
+        TEST_ASSERT(errors[1].token.Row() == 3);
+    }
+}
+
+void TestParseParallel()
+{
+    string code = "module first\n";
+    for (size_t i = 0; i < 50; i++)
+    {
+        string n = std::to_string(i);
+        code += "tag tag" + n + "\n";
+        code += "type type" + n + "\n    a\n    b" + n + "\nend\n";
+        code += "phrase Sum" + n + "(low)To(high)\n    result = low + high\nend\n";
+        if (i % 7 == 0) code += "tag\n";                       // no name
+        if (i % 11 == 0) code += "sentence Print(message)\n";   // no end
+        if (i % 13 == 0) code += "using std\nx = 1\n";          // left lines
+        if (i == 30) code += "module second\n";
+    }
+    auto codeFile = CodeFile::Parse(code);
+    CompileError::List errors;
+    auto module = Module::Parse(codeFile, errors);
+    TEST_ASSERT(!errors.empty());
+
+    auto ToLogs = [](const Module::Ptr & module){
+        std::vector<string> logs;
+        for (auto & usi : module->usings) logs.push_back(usi->ToLog());
+        for (auto & type : module->types) logs.push_back(type->ToLog());
+        for (auto & tag : module->tags) logs.push_back(tag->ToLog());
+        for (auto & func : module->functions) logs.push_back(func->ToLog());
+        return logs;
+    };
+    ThreadPool pool(4);
+    for (size_t batchLines : { 1, 5, 64, 1 << 20 })
+    {
+        CompileError::List parallelErrors;
+        auto parallel = Module::ParseParallel(codeFile, pool, parallelErrors, batchLines);
+        TEST_ASSERT(parallel->name == "second");
+        TEST_ASSERT(ToLogs(parallel) == ToLogs(module));
+        TEST_ASSERT(parallelErrors.size() == errors.size());
+        for (size_t i = 0; i < errors.size(); i++)
+        {
+            TEST_ASSERT(parallelErrors[i].errorType == errors[i].errorType);
+            TEST_ASSERT(parallelErrors[i].token.location == errors[i].token.location);
+        }
+    }
+
+    // every worker is parsing a module, none of them is free for the batches
+    std::atomic<size_t> started(0);
+    std::vector<std::future<size_t>> functionCounts;
+    for (size_t i = 0; i < pool.Size(); i++)
+    {
+        functionCounts.push_back(pool.Submit([&](){
+            started++;
+            while (started < pool.Size())
+                std::this_thread::yield();
+            CompileError::List parallelErrors;
+            return Module::ParseParallel(codeFile, pool, parallelErrors, 5)->functions.size();
+        }));
     }
+    for (auto & functionCount : functionCounts)
+        TEST_ASSERT(functionCount.get() == module->functions.size());
+}
+
+void TestFunctionBody()
+{
+    string code =
+        "module test\n"
+        "phrase Sum(low)To(high)\n"
+        "    var middle = (low + high) / 2\n"
+        "    result = middle * 2\n"
+        "    result\n"
+        "end\n"
+        "phrase Broken(value)\n"
+        "    var = value\n"
+        "    value 1\n"
+        "    unknown = 2\n"
+        "    result = value\n"
+        "end\n";
+    auto codeFile = CodeFile::Parse(code);
+    CompileError::List errors;
+    auto module = Module::Parse(codeFile, errors);
+    TEST_ASSERT(errors.empty());
+    TEST_ASSERT(module->functions.size() == 2);
+    // nothing parsed until asked
+    for (auto & func : module->functions)
+        TEST_ASSERT(func->body == nullptr);
+
+    SymbolStack stack;
+    stack.arena = module->arena;
+    auto item = std::make_shared<SymbolStackItem>();
+    item->LoadPredefinedSymbol();
+    item->functionTables = module->functions;
+    stack.Push(item);
+
+    auto sum = MaterializeBody(module->functions[0], stack);
+    TEST_ASSERT(sum != nullptr);
+    TEST_ASSERT(sum->errors.empty());
+    TEST_ASSERT(sum->ToLog() ==
+        "Var(middle, /(+((low:Unknown), (high:Unknown)), 2))\n"
+        "Assign(result, *((middle:Unknown), 2))\n"
+        "result\n");
+    TEST_ASSERT(MaterializeBody(module->functions[0], stack) == sum);
+    TEST_ASSERT(module->functions[0]->body == sum);
+    TEST_ASSERT(module->functions[1]->body == nullptr);
+
+    // errors stay with the body, the good lines are still there
+    auto broken = MaterializeBody(module->functions[1], stack);
+    TEST_ASSERT(broken->errors.size() == 3);
+    TEST_ASSERT(broken->errors[0].errorType == CompileErrorType::Parser_UnExpectedTokenType);
+    TEST_ASSERT(broken->errors[1].errorType == CompileErrorType::Parser_CanNotParseLeftToken);
+    TEST_ASSERT(broken->ToLog() ==
+        "(value:Unknown)\n"
+        "Assign(result, (value:Unknown))\n");
+    TEST_ASSERT(MaterializeBody(module->functions[1], stack) == broken);
+    stack.Pop();
 }
 
 void InvokeDeclarationParserTest()
@@ -273,5 +479,8 @@ void InvokeDeclarationParserTest()
     TestFunctionDeclaration();
     TestUsing();
     TestModule();
+    TestDeclarationIndex();
+    TestParseParallel();
+    TestFunctionBody();
     std::cout << "Declaration Parser Test Complete" << std::endl;
 }
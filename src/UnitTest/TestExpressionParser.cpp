@@ -2,23 +2,27 @@
 #include <string>
 
 #include "Compiler/Parser/ExpressionParser.h"
+#include "Compiler/Parser/FlatExpression.h"
 #include "Compiler/Lexer/Lexer.h"
 #include "Test.h"
 
 using std::string;
 using namespace minimoe;
 
-void Tokenize(const string & codeString, CodeToken::List & tokens)
+// tokens are owned by the CodeFile, keep the last one alive
+CodeFile::Ptr tokenizedFile;
+
+void Tokenize(const string & codeString, CodeLine & tokens)
 {
-    auto codeFile = CodeFile::Parse(codeString);
-    TEST_ASSERT(codeFile->errors.empty());
-    TEST_ASSERT(codeFile->lines.size() == 1);
-    tokens = codeFile->lines.back()->tokens;
+    tokenizedFile = CodeFile::Parse(codeString);
+    TEST_ASSERT(tokenizedFile->errors.empty());
+    TEST_ASSERT(tokenizedFile->lines.size() == 1);
+    tokens = tokenizedFile->lines.back();
 }
 
 void TestLiteral()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     // Integer
     {
@@ -28,9 +32,11 @@ void TestLiteral()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto literal = std::dynamic_pointer_cast<LiteralExpression>(exp);
+        auto literal = ExpressionCast<LiteralExpression>(exp);
         TEST_ASSERT(literal->type == LiteralType::Integer);
         TEST_ASSERT(literal->value == "233");
+        TEST_ASSERT(ExpressionCast<BinaryExpression>(exp) == nullptr);
+        TEST_ASSERT(stack.arena->AllocatedBytes() >= sizeof(LiteralExpression));
     }
     // Float
     {
@@ -40,7 +46,7 @@ void TestLiteral()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto literal = std::dynamic_pointer_cast<LiteralExpression>(exp);
+        auto literal = ExpressionCast<LiteralExpression>(exp);
         TEST_ASSERT(literal->type == LiteralType::Float);
         TEST_ASSERT(literal->value == "2.333");
     }
@@ -52,7 +58,7 @@ void TestLiteral()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto literal = std::dynamic_pointer_cast<LiteralExpression>(exp);
+        auto literal = ExpressionCast<LiteralExpression>(exp);
         TEST_ASSERT(literal->type == LiteralType::String);
         TEST_ASSERT(literal->value == "this is a string");
     }
@@ -64,7 +70,7 @@ void TestLiteral()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto literal = std::dynamic_pointer_cast<LiteralExpression>(exp);
+        auto literal = ExpressionCast<LiteralExpression>(exp);
         TEST_ASSERT(literal->type == LiteralType::Integer);
         TEST_ASSERT(literal->value == "1");
     }
@@ -72,7 +78,7 @@ void TestLiteral()
 
 void TestBinaryExpression()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     {
         Tokenize("1 and 2", tokens);
@@ -81,7 +87,7 @@ void TestBinaryExpression()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto bi = std::dynamic_pointer_cast<BinaryExpression>(exp);
+        auto bi = ExpressionCast<BinaryExpression>(exp);
         TEST_ASSERT(bi != nullptr);
         TEST_ASSERT(bi->ToLog() == "and(1, 2)");
     }
@@ -92,15 +98,50 @@ void TestBinaryExpression()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto bi = std::dynamic_pointer_cast<BinaryExpression>(exp);
+        auto bi = ExpressionCast<BinaryExpression>(exp);
         TEST_ASSERT(bi != nullptr);
         TEST_ASSERT(bi->ToLog() == "or(and(1, 2), and(and(3, 4), 5))");
     }
+    {
+        Tokenize("1 + 2 * 3 - 4 % 5 / 6", tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "-(+(1, *(2, 3)), /(%(4, 5), 6))");
+    }
+    {
+        Tokenize("1 < 2 and 3 + 4 == 5 or 6 <> 7 and 8 >= 9 and 1 <= 2 and 3 > 4", tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() ==
+            "or(and(<(1, 2), ==(+(3, 4), 5)), and(and(and(<>(6, 7), >=(8, 9)), <=(1, 2)), >(3, 4)))");
+    }
+    {
+        Tokenize("(1 + 2) * -3", tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "*(+(1, 2), -(3))");
+    }
+    {
+        // the operator without right operand is left to the caller
+        Tokenize("1 * 2 +", tokens);
+        CompileError::List errors;
+        auto head = tokens.begin();
+        auto exp = stack.ParseExpression(head, tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(exp->ToLog() == "*(1, 2)");
+        TEST_ASSERT(head->type == CodeTokenType::Add);
+    }
 }
 
 void TestUnaryExpression()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     {
         Tokenize("not 1", tokens);
@@ -109,7 +150,7 @@ void TestUnaryExpression()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto uexp = std::dynamic_pointer_cast<UnaryExpression>(exp);
+        auto uexp = ExpressionCast<UnaryExpression>(exp);
         TEST_ASSERT(uexp != nullptr);
         TEST_ASSERT(uexp->ToLog() == "not(1)");
     }
@@ -120,9 +161,9 @@ void TestUnaryExpression()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto bi = std::dynamic_pointer_cast<BinaryExpression>(exp);
+        auto bi = ExpressionCast<BinaryExpression>(exp);
         TEST_ASSERT(bi != nullptr);
-        auto u = std::dynamic_pointer_cast<UnaryExpression>(bi->rightOperand);
+        auto u = ExpressionCast<UnaryExpression>(bi->rightOperand);
         TEST_ASSERT(u != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(bi->ToLog() == "and(1, +(2))");
@@ -131,7 +172,7 @@ void TestUnaryExpression()
 
 void TestVariable()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     auto item = std::make_shared<SymbolStackItem>();
     item->LoadPredefinedSymbol();
@@ -154,7 +195,7 @@ void TestVariable()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto sexp = std::dynamic_pointer_cast<SymbolExpression>(exp);
+        auto sexp = ExpressionCast<SymbolExpression>(exp);
         TEST_ASSERT(sexp != nullptr);
         TEST_ASSERT(sexp->ToLog() == "(doyoubi:String)");
         TEST_ASSERT(sexp->symbol->symbolType == SymbolType::Variable);
@@ -163,7 +204,7 @@ void TestVariable()
         auto num = stack.ParsePrimitive(it, tokens.end(), errors);
         TEST_ASSERT(num != nullptr);
         TEST_ASSERT(errors.empty());
-        auto one = std::dynamic_pointer_cast<LiteralExpression>(num);
+        auto one = ExpressionCast<LiteralExpression>(num);
         TEST_ASSERT(one != nullptr);
         TEST_ASSERT(one->ToLog() == "1");
     }
@@ -174,13 +215,42 @@ void TestVariable()
         TEST_ASSERT(exp == nullptr);
         TEST_ASSERT(errors.size() == 1);
         TEST_ASSERT(errors.back().errorType == CompileErrorType::Parser_CanNotResolveSymbol);
-        TEST_ASSERT(errors.back().token->value == "NotDeclaredVar");
+        TEST_ASSERT(errors.back().token.value == "NotDeclaredVar");
+    }
+    {
+        // inner scopes shadow the outer ones until they are popped
+        AddVariable(Type::Integer, "doyoubi");
+        auto inner = stack.Top();
+        TEST_ASSERT(stack.ResolveSymbol("doyoubi") == inner->symbolTables.back());
+        TEST_ASSERT(stack.ResolveSymbol("doyoubi")->varDeclaration->type == Type::Integer);
+
+        // added to an outer scope after the inner one is pushed
+        auto declaration = std::make_shared<VariableDeclaration>();
+        declaration->type = Type::Float;
+        item->addSymbol(declaration, "doyoubi");
+        item->addSymbol(declaration, "outer");
+        TEST_ASSERT(stack.ResolveSymbol("doyoubi") == inner->symbolTables.back());
+        TEST_ASSERT(stack.ResolveSymbol("outer") == item->symbolTables.back());
+
+        stack.Pop();
+        TEST_ASSERT(stack.ResolveSymbol("doyoubi")->varDeclaration->type == Type::String);
+        stack.Pop();
+        TEST_ASSERT(stack.ResolveSymbol("doyoubi")->varDeclaration->type == Type::Float);
+        TEST_ASSERT(stack.ResolveSymbol("true")->keyword == Keyword::True);
+
+        for (size_t i = 0; i < 1000; i++)
+            AddVariable(Type::Integer, "var" + std::to_string(i % 100));
+        TEST_ASSERT(stack.ResolveSymbol("var42") == stack.stackItems[942 + 1]->symbolTables.back());
+        for (size_t i = 0; i < 1000; i++)
+            stack.Pop();
+        TEST_ASSERT(stack.ResolveSymbol("var42") == nullptr);
+        TEST_ASSERT(stack.ResolveSymbol("outer") == item->symbolTables.back());
     }
 }
 
 void TestBuiltInValue()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     auto item = std::make_shared<SymbolStackItem>();
     item->LoadPredefinedSymbol();
@@ -193,7 +263,7 @@ void TestBuiltInValue()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto vexp = std::dynamic_pointer_cast<SymbolExpression>(exp);
+        auto vexp = ExpressionCast<SymbolExpression>(exp);
         TEST_ASSERT(vexp != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(vexp->symbol->symbolType == SymbolType::Keyword);
@@ -208,7 +278,7 @@ void TestBuiltInValue()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto vexp = std::dynamic_pointer_cast<SymbolExpression>(exp);
+        auto vexp = ExpressionCast<SymbolExpression>(exp);
         TEST_ASSERT(vexp != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(vexp->symbol->symbolType == SymbolType::Keyword);
@@ -223,7 +293,7 @@ void TestBuiltInValue()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto vexp = std::dynamic_pointer_cast<SymbolExpression>(exp);
+        auto vexp = ExpressionCast<SymbolExpression>(exp);
         TEST_ASSERT(vexp != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(vexp->symbol->symbolType == SymbolType::Keyword);
@@ -235,7 +305,7 @@ void TestBuiltInValue()
 
 void TestBuiltInType()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     auto item = std::make_shared<SymbolStackItem>();
     item->LoadPredefinedSymbol();
@@ -248,7 +318,7 @@ void TestBuiltInType()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto sexp = std::dynamic_pointer_cast<SymbolExpression>(exp);
+        auto sexp = ExpressionCast<SymbolExpression>(exp);
         TEST_ASSERT(sexp != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(sexp->symbol->symbolType == SymbolType::Type);
@@ -260,7 +330,7 @@ void TestBuiltInType()
 
 void TestFunction()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     auto item = std::make_shared<SymbolStackItem>();
     item->LoadPredefinedSymbol();
@@ -282,7 +352,7 @@ void TestFunction()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto fexp = std::dynamic_pointer_cast<FunctionInvokeExpression>(exp);
+        auto fexp = ExpressionCast<FunctionInvokeExpression>(exp);
         TEST_ASSERT(fexp != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(fexp->ToLog() == "func(null)");
@@ -299,7 +369,7 @@ void TestFunction()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto fexp = std::dynamic_pointer_cast<FunctionInvokeExpression>(exp);
+        auto fexp = ExpressionCast<FunctionInvokeExpression>(exp);
         TEST_ASSERT(fexp != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(fexp->ToLog() == "SumFrom_To(1, 100)");
@@ -314,8 +384,30 @@ void TestFunction()
         auto e2 = stack.ParseInvokeFunction(tokens.begin(), tokens.end(), errors);
         TEST_ASSERT(!errors.empty());
         TEST_ASSERT(errors.back().errorType == CompileErrorType::Parser_UnExpectedTokenType);
+        TEST_ASSERT(errors.back().Message() == "expect token type identifier but got (");
+        errors.clear();
+
+        Tokenize("SumFrom(1)From(100)", tokens);
+        auto e3 = stack.ParseInvokeFunction(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(e3 == nullptr);
+        TEST_ASSERT(errors.back().errorType == CompileErrorType::Parser_WrongFunctionName);
+        TEST_ASSERT(errors.back().Message() == "expect function name fragment \"To\" but get\"From\"");
         errors.clear();
 
+        Tokenize("SumFrom(1 +)To(2)", tokens);
+        auto e4 = stack.ParseOneFunction(tokens.begin(), tokens.end(), decl, errors);
+        TEST_ASSERT(e4 == nullptr);
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.back().errorType == CompileErrorType::Parser_UnExpectedTokenType);
+        TEST_ASSERT(errors.back().token.type == CodeTokenType::Add);
+        errors.clear();
+
+        // the errors of the failed attempts are rolled back once the expression is parsed
+        Tokenize("SumFrom((1))To((2,))", tokens);
+        exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+
         stack.Pop();
     }
     {
@@ -329,25 +421,68 @@ void TestFunction()
         TEST_ASSERT(exp != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto bi = std::dynamic_pointer_cast<BinaryExpression>(exp);
+        auto bi = ExpressionCast<BinaryExpression>(exp);
         TEST_ASSERT(bi != nullptr);
         TEST_ASSERT(errors.empty());
 
-        auto fexp = std::dynamic_pointer_cast<FunctionInvokeExpression>(bi->leftOperand);
+        auto fexp = ExpressionCast<FunctionInvokeExpression>(bi->leftOperand);
         TEST_ASSERT(fexp != nullptr);
         TEST_ASSERT(errors.empty());
         TEST_ASSERT(fexp->ToLog() == "IsType(233, Integer)");
 
-        auto t = std::dynamic_pointer_cast<SymbolExpression>(bi->rightOperand);
+        auto t = ExpressionCast<SymbolExpression>(bi->rightOperand);
         TEST_ASSERT(t != nullptr);
         TEST_ASSERT(t->ToLog() == "true");
         stack.Pop();
     }
+    {
+        // functions sharing fragments in the same scope, the first declared one which matches wins
+        auto funcItem = std::make_shared<SymbolStackItem>();
+        for (size_t i = 0; i < 1000; i++)
+            funcItem->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+                ->name("Func" + std::to_string(i))->arg(FunctionArgumentType::Normal, "x"));
+        funcItem->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+            ->name("Print")->arg(FunctionArgumentType::Normal, "x")->name("To")->arg(FunctionArgumentType::Normal, "y"));
+        funcItem->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+            ->name("Print")->arg(FunctionArgumentType::Normal, "x"));
+        funcItem->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+            ->arg(FunctionArgumentType::Normal, "x")->name("Print"));
+        stack.Push(funcItem);
+
+        Tokenize("Print(Print(1)To(2))", tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "Print(Print_To(1, 2))");
+
+        Tokenize("Func233((1 + 2) * 3) + (Func7(4))Print", tokens);
+        exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "+(Func233(*(+(1, 2), 3)), Print(Func7(4)))");
+
+        // functions added later are found too
+        funcItem->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+            ->name("Later"));
+        Tokenize("Later", tokens);
+        exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(exp->ToLog() == "Later()");
+
+        Tokenize("Print(1)To", tokens);
+        auto head = tokens.begin();
+        exp = stack.ParseInvokeFunction(head, tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(exp->ToLog() == "Print(1)");
+        TEST_ASSERT(head->value == "To");
+        stack.Pop();
+    }
 }
 
 void TestList()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     auto item = std::make_shared<SymbolStackItem>();
     item->LoadPredefinedSymbol();
@@ -394,11 +529,34 @@ void TestList()
         auto error = errors.front();
         TEST_ASSERT(error.errorType == CompileErrorType::Parser_OneElementListShouldEndWithComma);
     }
+    {
+        Tokenize("(1, 2 3)", tokens);
+        CompileError::List errors;
+        auto head = tokens.begin();
+        auto exp = stack.ParseList(head, tokens.end(), errors);
+        TEST_ASSERT(exp == nullptr);
+        TEST_ASSERT(head == tokens.begin());
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.front().errorType == CompileErrorType::Parser_UnExpectedTokenType);
+        TEST_ASSERT(errors.front().token.value == "3");
+
+        Tokenize("((1), 2,)", tokens);
+        exp = stack.ParseList(tokens.begin(), tokens.end(), errors = {});
+        TEST_ASSERT(exp == nullptr);
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.front().errorType == CompileErrorType::Parser_NotOneElementListShouldNotEndWithComma);
+
+        Tokenize("((1), (2,))", tokens);
+        exp = stack.ParseList(tokens.begin(), tokens.end(), errors = {});
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "List(1, List(2))");
+    }
 }
 
 void TestComplexExpression()
 {
-    CodeToken::List tokens;
+    CodeLine tokens;
     SymbolStack stack;
     auto item = std::make_shared<SymbolStackItem>();
     item->LoadPredefinedSymbol();
@@ -413,6 +571,216 @@ void TestComplexExpression()
     }
 }
 
+void TestMemoization()
+{
+    CodeLine tokens;
+    SymbolStack stack;
+    auto item = std::make_shared<SymbolStackItem>();
+    item->LoadPredefinedSymbol();
+    item->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+        ->name("Print")->arg(FunctionArgumentType::Normal, "x"));
+    stack.Push(item);
+
+    auto nest = [](const string & exp, size_t depth){
+        return string(depth, '(') + exp + string(depth, ')');
+    };
+    // the same results and errors as parsing without the cache
+    for (auto & code : {
+        nest("1 + 2", 8),
+        "Print" + nest("-(1, (2,), " + nest("true", 3) + ") * 3", 5),
+        nest("(1,", 6),
+        nest("1, 2,", 6) })
+    {
+        Tokenize(code, tokens);
+        CompileError::List errors, memoErrors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        stack.memoization = true;
+        auto memoExp = stack.ParseExpression(tokens.begin(), tokens.end(), memoErrors);
+        stack.memoization = false;
+        TEST_ASSERT((exp == nullptr) == (memoExp == nullptr));
+        TEST_ASSERT(exp == nullptr || exp->ToLog() == memoExp->ToLog());
+        TEST_ASSERT(errors.size() == memoErrors.size());
+        for (size_t i = 0; i < errors.size(); i++)
+        {
+            TEST_ASSERT(errors[i].errorType == memoErrors[i].errorType);
+            TEST_ASSERT(errors[i].token.location == memoErrors[i].token.location);
+        }
+    }
+    // exponential without the cache
+    {
+        stack.memoization = true;
+        Tokenize("Print" + nest("1 + Print" + nest("(1,)", 30), 30), tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "Print(+(1, Print(List(1))))");
+    }
+}
+
+void TestDeepExpression()
+{
+    CodeLine tokens;
+    SymbolStack stack;
+    auto item = std::make_shared<SymbolStackItem>();
+    item->LoadPredefinedSymbol();
+    item->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+        ->name("Print")->arg(FunctionArgumentType::Normal, "x"));
+    stack.Push(item);
+
+    auto repeat = [](const string & s, size_t count){
+        string result;
+        for (size_t i = 0; i < count; i++)
+            result += s;
+        return result;
+    };
+    const size_t depth = 5000;
+    stack.maxDepth = 4 * depth;
+    // far deeper than the call stack allows for parsing recursively,
+    // nothing walking the trees recurses either, the test runs with a stack of 1MB
+    {
+        Tokenize(repeat("not ", depth) + "true", tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        size_t count = 0;
+        while (auto unaryExp = ExpressionCast<UnaryExpression>(exp))
+        {
+            TEST_ASSERT(unaryExp->unaryOperator == UnaryOperator::Not);
+            exp = unaryExp->operand;
+            count++;
+        }
+        TEST_ASSERT(count == depth);
+        TEST_ASSERT(exp->ToLog() == "true");
+    }
+    {
+        Tokenize(repeat("(", depth) + "1 + 2" + repeat(")", depth) + " * 3", tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "*(+(1, 2), 3)");
+    }
+    {
+        Tokenize(repeat("Print(-", depth) + "1" + repeat(")", depth), tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == repeat("Print(-(", depth) + "1" + repeat("))", depth));
+        FlatExpressionTree tree;
+        TEST_ASSERT(tree.Append(exp) == 2 * depth);
+        TEST_ASSERT(tree.Type(0) == ExpressionType::Literal);
+        TEST_ASSERT(tree.SubtreeBegin(2 * depth) == 0);
+    }
+    // nothing takes back the error of being too deep
+    stack.maxDepth = depth;
+    for (auto & code : {
+        repeat("not ", depth) + "true",
+        "1 + " + repeat("(", depth) + "1" + repeat(")", depth),
+        "Print(" + repeat("(", depth) + "1" + repeat(")", depth) + ")" })
+    {
+        Tokenize(code, tokens);
+        CompileError::List errors;
+        auto head = tokens.begin();
+        auto exp = stack.ParseExpression(head, tokens.end(), errors);
+        TEST_ASSERT(exp == nullptr);
+        TEST_ASSERT(head == tokens.begin());
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.front().errorType == CompileErrorType::Parser_ExpressionTooDeep);
+    }
+    // so is it for the function invoking and the list parsed by themselves
+    {
+        Tokenize(repeat("Print(", depth) + "1" + repeat(")", depth), tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseInvokeFunction(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp == nullptr);
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.front().errorType == CompileErrorType::Parser_ExpressionTooDeep);
+
+        Tokenize("(" + repeat("(", depth) + "1" + repeat(")", depth) + ",)", tokens);
+        errors.clear();
+        exp = stack.ParseList(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp == nullptr);
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.front().errorType == CompileErrorType::Parser_ExpressionTooDeep);
+    }
+    // the right operand not found, the expression ends before the operator
+    {
+        Tokenize("1 * 2 + 3 * - )", tokens);
+        CompileError::List errors;
+        auto head = tokens.begin();
+        auto exp = stack.ParseExpression(head, tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        TEST_ASSERT(errors.empty());
+        TEST_ASSERT(exp->ToLog() == "+(*(1, 2), 3)");
+        TEST_ASSERT(head->type == CodeTokenType::Mul);
+    }
+    // neither a list nor an expression in brackets
+    {
+        Tokenize("(1, 2 3)", tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp == nullptr);
+        TEST_ASSERT(errors.size() == 1);
+        TEST_ASSERT(errors.front().errorType == CompileErrorType::Parser_CloseBracketNotFound);
+        TEST_ASSERT(errors.front().token.type == CodeTokenType::Comma);
+    }
+}
+
+void TestFlatExpression()
+{
+    CodeLine tokens;
+    SymbolStack stack;
+    auto item = std::make_shared<SymbolStackItem>();
+    item->LoadPredefinedSymbol();
+    item->functionTables.push_back(FunctionDeclaration::Make(FunctionType::Phrase)
+        ->name("SumFrom")->arg(FunctionArgumentType::Normal, "min")
+        ->name("To")->arg(FunctionArgumentType::Normal, "max"));
+    stack.Push(item);
+
+    FlatExpressionTree tree;
+    std::vector<FlatExpressionTree::NodeIndex> roots;
+    for (auto & code : {
+        "(1,2,3) or (1 and 2) and \"doyoubi\"",
+        "SumFrom(1 + -2)To((true, Integer)) * 3",
+        "233" })
+    {
+        Tokenize(code, tokens);
+        CompileError::List errors;
+        auto exp = stack.ParseExpression(tokens.begin(), tokens.end(), errors);
+        TEST_ASSERT(exp != nullptr);
+        roots.push_back(tree.Append(exp));
+        TEST_ASSERT(tree.ToLog(roots.back()) == exp->ToLog());
+    }
+    TEST_ASSERT(tree.Size() == 10 + 10 + 1);
+    TEST_ASSERT(roots[0] == 9 && roots[1] == 19 && roots[2] == 20);
+
+    auto root = roots[1];
+    TEST_ASSERT(tree.Type(root) == ExpressionType::Binary);
+    TEST_ASSERT(tree.GetBinaryOperator(root) == BinaryOperator::Mul);
+    auto operands = tree.Children(root);
+    TEST_ASSERT(operands.size() == 2);
+    TEST_ASSERT(tree.Type(operands[0]) == ExpressionType::FunctionInvoke);
+    TEST_ASSERT(tree.GetFunction(operands[0]) == item->functionTables.front());
+    TEST_ASSERT(tree.Children(operands[0]).size() == 2);
+    TEST_ASSERT(tree.GetLiteralValue(operands[1]) == "3");
+    TEST_ASSERT(tree.SubtreeBegin(root) == roots[0] + 1);
+
+    // children are always visited before their parent
+    std::vector<bool> visited(tree.Size(), false);
+    size_t literalCount = 0;
+    tree.VisitPostOrder(root, [&](FlatExpressionTree::NodeIndex node){
+        for (auto child : tree.Children(node))
+            TEST_ASSERT(visited[child]);
+        visited[node] = true;
+        literalCount += tree.Type(node) == ExpressionType::Literal;
+    });
+    TEST_ASSERT(literalCount == 3);
+    TEST_ASSERT(!visited[roots[0]] && !visited[roots[2]]);
+}
+
 void InvokeExpressionParserTest()
 {
     TestLiteral();
@@ -424,5 +792,8 @@ void InvokeExpressionParserTest()
     TestFunction();
     TestList();
     TestComplexExpression();
+    TestMemoization();
+    TestDeepExpression();
+    TestFlatExpression();
     std::cout << "Expresion Parser Test Complete" << std::endl;
 }
@@ -1,21 +1,32 @@
 #include <string>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <atomic>
+#include <stdexcept>
 
 #include "Compiler/Lexer/Lexer.h"
+#include "Compiler/Lexer/CharScanner.h"
+#include "Compiler/Lexer/CodeLineStream.h"
+#include "Utils/ThreadPool.h"
 #include "UnitTest/Test.h"
 
 using std::string;
 using std::vector;
 using namespace minimoe;
 
+// every test case runs once for each engine
+LexerEngine lexerEngine = LexerEngine::StateMachine;
+
 struct LexerTester
 {
     CodeFile::Ptr codeFile;
-    CodeLine::List::iterator lineIterator;
-    CodeToken::List::iterator tokenIterator;
+    LineIter lineIterator;
+    TokenIter tokenIterator;
     CompileError::List::iterator errorIterator;
 
     LexerTester(const string & code)
-        : codeFile(CodeFile::Parse(code))
+        : codeFile(CodeFile::Parse(code, lexerEngine))
     {
     }
 
@@ -47,23 +58,23 @@ void LexerTester::LastLine(const string & file, size_t line)
 void LexerTester::FirstToken(size_t count, const string & file, size_t line)
 {
     auto & codeLine = *lineIterator;
-    test_assert(codeLine->tokens.size() == count, file, line);
-    tokenIterator = codeLine->tokens.begin();
+    test_assert(codeLine.size() == count, file, line);
+    tokenIterator = codeLine.begin();
 }
 void LexerTester::Token(size_t row, size_t column, const string & value, CodeTokenType type,
     const string & file, size_t line)
 {
-    auto token = *tokenIterator;
-    test_assert(tokenIterator != (*lineIterator)->tokens.end(), file, line);
-    test_assert(token->row == row, file, line);
-    test_assert(token->column == column, file, line);
-    test_assert(token->value == value, file, line);
-    test_assert(token->type == type, file, line);
+    test_assert(tokenIterator != lineIterator->end(), file, line);
+    auto & token = *tokenIterator;
+    test_assert(token.Row() == row, file, line);
+    test_assert(token.Column() == column, file, line);
+    test_assert(token.value == value, file, line);
+    test_assert(token.type == type, file, line);
     tokenIterator++;
 }
 void LexerTester::LastToken(const string & file, size_t line)
 {
-    test_assert(tokenIterator == (*lineIterator)->tokens.end(), file, line);
+    test_assert(tokenIterator == lineIterator->end(), file, line);
 }
 void LexerTester::begin_check_error(size_t count, const string & file, size_t line)
 {
@@ -74,10 +85,10 @@ void LexerTester::error(CompileErrorType errorType, size_t row, size_t column, c
     const string & file, size_t line, CodeTokenType type)
 {
     test_assert(errorIterator->errorType == errorType, file, line);
-    test_assert(errorIterator->token->row == row, file, line);
-    test_assert(errorIterator->token->column == column, file, line);
-    test_assert(errorIterator->token->value == value, file, line);
-    test_assert(errorIterator->token->type == type, file, line);
+    test_assert(errorIterator->token.Row() == row, file, line);
+    test_assert(errorIterator->token.Column() == column, file, line);
+    test_assert(errorIterator->token.value == value, file, line);
+    test_assert(errorIterator->token.type == type, file, line);
     ++errorIterator;
 }
 void LexerTester::end_check_error(const string & file, size_t line)
@@ -382,6 +393,21 @@ void testString()
     END_CHECK_ERROR;
 }
 
+void testManyEscapedStrings()
+{
+    // enough unescaped strings to fill several blocks
+    string code;
+    for (size_t i = 0; i < 1000; i++)
+        code += "\"\\t" + std::to_string(i) + " \\\"quoted\\\"\"\n";
+    code += "\"" + string(5000, 'x') + "\\n\"\n";
+    auto codeFile = CodeFile::Parse(code, lexerEngine);
+    TEST_ASSERT(codeFile->errors.empty());
+    TEST_ASSERT(codeFile->tokens.size() == 1001);
+    for (size_t i = 0; i < 1000; i++)
+        TEST_ASSERT(codeFile->tokens[i].value == "\t" + std::to_string(i) + " \"quoted\"");
+    TEST_ASSERT(codeFile->tokens.back().value == string(5000, 'x') + "\n");
+}
+
 void testIdentifier()
 {
     {
@@ -507,7 +533,289 @@ void testOperator()
     END_CHECK_ERROR;
 }
 
-void InvokeLexerTest()
+void checkSameCodeFile(CodeFile::Ptr expectedFile, CodeFile::Ptr actualFile)
+{
+    TEST_ASSERT(expectedFile->lines.size() == actualFile->lines.size());
+    for (size_t l = 0; l < expectedFile->lines.size(); l++)
+        TEST_ASSERT(expectedFile->lines[l].size() == actualFile->lines[l].size());
+    TEST_ASSERT(expectedFile->tokens.size() == actualFile->tokens.size());
+    for (size_t t = 0; t < expectedFile->tokens.size(); t++)
+    {
+        auto & expected = expectedFile->tokens[t];
+        auto & actual = actualFile->tokens[t];
+        TEST_ASSERT(expected.Row() == actual.Row());
+        TEST_ASSERT(expected.Column() == actual.Column());
+        TEST_ASSERT(expected.value == actual.value);
+        TEST_ASSERT(expected.name == actual.name);
+        TEST_ASSERT(expected.type == actual.type);
+    }
+    TEST_ASSERT(expectedFile->errors.size() == actualFile->errors.size());
+    for (size_t e = 0; e < expectedFile->errors.size(); e++)
+    {
+        auto & expected = expectedFile->errors[e];
+        auto & actual = actualFile->errors[e];
+        TEST_ASSERT(expected.errorType == actual.errorType);
+        TEST_ASSERT(expected.token.Row() == actual.token.Row());
+        TEST_ASSERT(expected.token.Column() == actual.token.Column());
+        TEST_ASSERT(expected.token.value == actual.token.value);
+        TEST_ASSERT(expected.token.type == actual.token.type);
+        TEST_ASSERT(expected.argument == actual.argument);
+        TEST_ASSERT(expected.Message() == actual.Message());
+    }
+}
+
+void testEnginesAgree()
+{
+    const char chars[] = "ab_Z09.\"\\-<>=[](),:+*/%\n\t\r $#";
+    const size_t charCount = sizeof(chars) - 1;
+    size_t seed = 233;
+    for (size_t i = 0; i < 2000; i++)
+    {
+        string code;
+        for (size_t j = 0; j < i % 64; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            code += chars[(seed >> 16) % charCount];
+        }
+        auto stateMachine = CodeFile::Parse(code, LexerEngine::StateMachine);
+        auto table = CodeFile::Parse(code, LexerEngine::TableDriven);
+        checkSameCodeFile(stateMachine, table);
+    }
+}
+
+void testParseParallel()
+{
+    const char chars[] = "ab_Z09.\"\\-<>=[](),:+*/%\n\n\t $#";
+    const size_t charCount = sizeof(chars) - 1;
+    ThreadPool pool(4);
+    size_t seed = 233;
+    for (size_t i = 0; i < 200; i++)
+    {
+        string code;
+        for (size_t j = 0; j < i * 4; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            code += chars[(seed >> 16) % charCount];
+        }
+        auto serial = CodeFile::Parse(code, lexerEngine);
+        // small chunks so that there are plenty of them
+        auto parallel = CodeFile::ParseParallel(string(code), pool, i % 16, lexerEngine);
+        checkSameCodeFile(serial, parallel);
+    }
+
+    // from the only worker of the pool, which can't wait for the chunks it's supposed to lex
+    ThreadPool onePool(1);
+    string code = "module a\nusing b\n\"c\" 1 2.0\n";
+    auto serial = CodeFile::Parse(code, lexerEngine);
+    auto parallel = onePool.Submit([&](){ return CodeFile::ParseParallel(string(code), onePool, 4, lexerEngine); }).get();
+    checkSameCodeFile(serial, parallel);
+
+    // an exception of any index comes out of ParallelFor after all the others are done
+    for (size_t failedIndex : { 0, 37, 99 })
+    {
+        std::atomic<size_t> running(0);
+        bool thrown = false;
+        try
+        {
+            pool.ParallelFor(100, [&](size_t i){
+                running++;
+                if (i == failedIndex)
+                {
+                    running--;
+                    throw std::runtime_error("chunk failed");
+                }
+                running--;
+            });
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        TEST_ASSERT(thrown);
+        TEST_ASSERT(running == 0);
+    }
+}
+
+void testCodeLineStream()
+{
+    const char chars[] = "ab_Z09.\"\\-<>=[](),:+*/%\n\n\t $#";
+    const size_t charCount = sizeof(chars) - 1;
+    size_t seed = 233;
+    for (size_t i = 0; i < 200; i++)
+    {
+        string code;
+        for (size_t j = 0; j < i * 4; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            code += chars[(seed >> 16) % charCount];
+        }
+        auto expected = CodeFile::Parse(code, lexerEngine);
+
+        size_t readPosition = 0;
+        CodeLineStream stream([&](char * buffer, size_t size){
+            size_t count = std::min(size, code.size() - readPosition);
+            code.copy(buffer, count, readPosition);
+            readPosition += count;
+            return count;
+        }, i % 16 + 1, lexerEngine);
+        // keep the lines alive to compare them after all
+        CodeFile::List chunks;
+        auto actual = std::make_shared<CodeFile>();
+        std::vector<size_t> lineSizes;
+        CodeLine line;
+        while (stream.Next(line))
+        {
+            chunks.push_back(stream.CurrentChunk());
+            actual->tokens.insert(actual->tokens.end(), line.begin(), line.end());
+            lineSizes.push_back(line.size());
+        }
+        auto tokenIt = actual->tokens.begin();
+        for (auto lineSize : lineSizes)
+        {
+            actual->lines.push_back({ tokenIt, tokenIt + lineSize });
+            tokenIt += lineSize;
+        }
+        actual->errors = stream.errors;
+        checkSameCodeFile(expected, actual);
+    }
+}
+
+void testMappedFile()
+{
+    const string path = "minimoe_lexer_test.moe";
+    const string code = "module test\nsentence print(message)\n    RedirectTo(\"print\\n\")\nend\n";
+    {
+        std::ofstream output(path, std::ios::binary);
+        output << code;
+    }
+    string errorMsg;
+    auto file = MappedFile::Open(path, errorMsg);
+    TEST_ASSERT(file != nullptr);
+    TEST_ASSERT(file->size() == code.size());
+    checkSameCodeFile(CodeFile::Parse(code, lexerEngine), CodeFile::Parse(file, lexerEngine));
+    file = nullptr;
+    std::remove(path.c_str());
+
+    TEST_ASSERT(MappedFile::Open("minimoe_no_such_file.moe", errorMsg) == nullptr);
+    TEST_ASSERT(!errorMsg.empty());
+}
+
+void testSourceLocation()
+{
+    auto codeFile = CodeFile::Parse("module a\n\n  \"b\" c\n", lexerEngine);
+    TEST_ASSERT(codeFile->tokens.size() == 4);
+    auto & token = codeFile->tokens[2];
+    TEST_ASSERT(token.location == codeFile->sourceBase + 12);
+    auto position = SourceManager::Instance().Resolve(token.location);
+    TEST_ASSERT(position.row == 3);
+    TEST_ASSERT(position.column == 3);
+
+    // the rows are kept for the text added after it
+    auto otherFile = CodeFile::Parse("x", lexerEngine);
+    TEST_ASSERT(otherFile->tokens.front().Row() == 1);
+    TEST_ASSERT(otherFile->tokens.front().Column() == 1);
+    TEST_ASSERT(token.Row() == 3);
+
+    CodeToken copied = token;
+    codeFile = nullptr;
+    TEST_ASSERT(copied.Row() == 0);
+    TEST_ASSERT(CodeToken().Row() == 0);
+
+    // the ranges of the removed texts are taken again once the offsets are used up.
+    // the huge texts are never resolved, so nothing reads them
+    auto & manager = SourceManager::Instance();
+    const size_t hugeSize = 3000000000u;
+    // an empty mapped file has no chars at all, but it's not removed
+    auto empty = manager.AddSource(nullptr, 0);
+    auto first = manager.AddSource("", hugeSize);
+    manager.RemoveSource(first);
+    auto second = manager.AddSource("", hugeSize);
+    TEST_ASSERT(second == first);
+    TEST_ASSERT(manager.Resolve(empty).row == 1);
+    manager.RemoveSource(empty);
+    TEST_ASSERT(manager.Resolve(empty).row == 0);
+    manager.RemoveSource(second);
+    TEST_ASSERT(otherFile->tokens.front().Row() == 1);
+    TEST_ASSERT(copied.Row() == 0);
+    auto afterFile = CodeFile::Parse("\ny", lexerEngine);
+    TEST_ASSERT(afterFile->tokens.front().Row() == 2);
+}
+
+void testName()
+{
+    auto codeFile = CodeFile::Parse("type abc\nabc ab \"abc\" 1 end", lexerEngine);
+    auto & tokens = codeFile->tokens;
+    TEST_ASSERT(tokens.size() == 7);
+    TEST_ASSERT(tokens[0].name.empty());
+    TEST_ASSERT(tokens[1].name == tokens[2].name);
+    TEST_ASSERT(tokens[1].name != tokens[3].name);
+    TEST_ASSERT(tokens[1].name.ToString() == "abc");
+    TEST_ASSERT(tokens[4].name.empty() && tokens[5].name.empty() && tokens[6].name.empty());
+
+    // the ids live longer than the texts they came from
+    Name name = tokens[3].name;
+    codeFile = nullptr;
+    TEST_ASSERT(name == Name("ab"));
+    TEST_ASSERT(name.View() == "ab");
+    TEST_ASSERT(Name("").empty());
+    // an empty view may point to nothing, and hashes the same as any other empty view
+    TEST_ASSERT(StringViewHash()(StringView()) == StringViewHash()(StringView("")));
+    TEST_ASSERT(StringViewHash()(StringView("abcdefghij")) == StringViewHash()(string("abcdefghij")));
+
+    // interned by several threads at the same time
+    ThreadPool pool(4);
+    vector<std::future<vector<Name>>> results;
+    for (size_t t = 0; t < 4; t++)
+    {
+        results.push_back(pool.Submit([]{
+            vector<Name> names;
+            for (size_t i = 0; i < 1000; i++)
+                names.push_back(Name("name" + std::to_string(i)));
+            return names;
+        }));
+    }
+    auto expected = results[0].get();
+    for (size_t t = 1; t < 4; t++)
+    {
+        auto names = results[t].get();
+        TEST_ASSERT(names == expected);
+    }
+    for (size_t i = 0; i < 1000; i++)
+        TEST_ASSERT(expected[i].ToString() == "name" + std::to_string(i));
+}
+
+void testCharScanner()
+{
+    const char chars[] = "a \t\"\\\n-";
+    const size_t charCount = sizeof(chars) - 1;
+    auto & scalar = GetCharScanner(SimdLevel::Scalar);
+    size_t seed = 233;
+    for (size_t i = 0; i < 1000; i++)
+    {
+        // mostly the same char, so that the kernels have to go through several blocks
+        string code(i % 100, chars[i % charCount]);
+        for (size_t j = 0; j < 3; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            if (!code.empty())
+                code[(seed >> 16) % code.size()] = chars[(seed >> 8) % charCount];
+        }
+        const char * begin = code.data();
+        const char * end = begin + code.size();
+        for (int level = static_cast<int>(SimdLevel::Scalar); level <= static_cast<int>(DetectSimdLevel()); level++)
+        {
+            auto & scanner = GetCharScanner(static_cast<SimdLevel>(level));
+            for (const char * head = begin; head <= end; head += 7)
+            {
+                TEST_ASSERT(scanner.FindLineEnd(head, end) == scalar.FindLineEnd(head, end));
+                TEST_ASSERT(scanner.FindStringEnd(head, end) == scalar.FindStringEnd(head, end));
+                TEST_ASSERT(scanner.SkipBlanks(head, end) == scalar.SkipBlanks(head, end));
+            }
+        }
+    }
+}
+
+void InvokeLexerTestCases()
 {
     testEmptyFile();
     testPrimitiveToken();
@@ -518,8 +826,24 @@ void InvokeLexerTest()
     testError();
     testFloat();
     testString();
+    testManyEscapedStrings();
     testIdentifier();
     testComment();
     testOperator();
+    testParseParallel();
+    testCodeLineStream();
+    testMappedFile();
+    testSourceLocation();
+    testName();
+}
+
+void InvokeLexerTest()
+{
+    lexerEngine = LexerEngine::StateMachine;
+    InvokeLexerTestCases();
+    lexerEngine = LexerEngine::TableDriven;
+    InvokeLexerTestCases();
+    testEnginesAgree();
+    testCharScanner();
     std::cout << "Lexer Test Complete" << std::endl;
 }
@@ -0,0 +1,316 @@
+#include <string>
+#include <algorithm>
+#include <cstdio>
+
+#include "Compiler/Project.h"
+#include "Compiler/ModuleInterface.h"
+#include "Compiler/Parser/FunctionBody.h"
+#include "Utils/ThreadPool.h"
+#include "UnitTest/Test.h"
+
+using std::string;
+using namespace minimoe;
+
+namespace
+{
+    bool HasError(const ModuleUnit::Ptr & unit, CompileErrorType errorType)
+    {
+        return std::any_of(unit->errors.begin(), unit->errors.end(),
+            [=](const CompileError & error){ return error.errorType == errorType; });
+    }
+}
+
+void TestProjectOrder()
+{
+    // top uses left and right, both use bottom
+    Project project;
+    auto top = project.AddSource("top.moe",
+        "module top\n"
+        "using left\n"
+        "using right\n"
+        "phrase Main(value)\n"
+        "    result = Left(value) + Right(value)\n"
+        "end\n");
+    auto left = project.AddSource("left.moe",
+        "module left\n"
+        "using bottom\n"
+        "phrase Left(value)\n"
+        "    result = Sum(value)To(1)\n"
+        "end\n");
+    auto right = project.AddSource("right.moe",
+        "module right\n"
+        "using bottom\n"
+        "phrase Right(value)\n"
+        "    var point = Point\n"
+        "    result = Sum(value)To(2)\n"
+        "end\n");
+    auto bottom = project.AddSource("bottom.moe",
+        "module bottom\n"
+        "type Point\n"
+        "    x\n"
+        "end\n"
+        "phrase Sum(low)To(high)\n"
+        "    result = low + high\n"
+        "end\n");
+
+    ThreadPool pool(4);
+    TEST_ASSERT(project.Build(pool));
+    for (auto & unit : project.units)
+    {
+        TEST_ASSERT(unit->Succeeded());
+        TEST_ASSERT(unit->module->functions[0]->body != nullptr);
+        for (auto & dependency : unit->dependencies)
+            TEST_ASSERT(project.units[dependency.unit]->finishTime <= unit->finishTime);
+    }
+    TEST_ASSERT(top->dependencies.size() == 2);
+    TEST_ASSERT(bottom->dependents.size() == 2);
+    TEST_ASSERT(top->module->functions[0]->body->ToLog() == "Assign(result, +(Left((value:Unknown)), Right((value:Unknown))))\n");
+    TEST_ASSERT(right->module->functions[0]->body->ToLog() ==
+        "Var(point, Point)\n"
+        "Assign(result, Sum_To((value:Unknown), 2))\n");
+
+    // bottom, left or right, then top
+    TEST_ASSERT(project.criticalPath.size() == 3);
+    TEST_ASSERT(project.units[project.criticalPath.front()] == bottom);
+    TEST_ASSERT(project.units[project.criticalPath.back()] == top);
+    TEST_ASSERT(project.criticalPathTime <= project.workTime);
+}
+
+void TestProjectErrors()
+{
+    {
+        // only the functions of the modules used directly are visible
+        Project project;
+        auto user = project.AddSource("user.moe",
+            "module user\n"
+            "using middle\n"
+            "using missing\n"
+            "phrase Use(value)\n"
+            "    result = Hidden(value)\n"
+            "end\n");
+        project.AddSource("middle.moe", "module middle\nusing hidden\n");
+        project.AddSource("hidden.moe", "module hidden\nphrase Hidden(value)\n    result = value\nend\n");
+        auto duplicated = project.AddSource("another.moe", "module middle\n");
+        auto notFound = project.AddFile("not/found.moe");
+
+        ThreadPool pool(2);
+        TEST_ASSERT(!project.Build(pool));
+        TEST_ASSERT(user->errors.size() == 2);
+        TEST_ASSERT(user->errors[0].errorType == CompileErrorType::Project_ModuleNotFound);
+        TEST_ASSERT(user->errors[0].token.value == "missing");
+        TEST_ASSERT(user->errors[1].errorType == CompileErrorType::Parser_CanNotResolveSymbol);
+        TEST_ASSERT(user->dependencies.size() == 1);
+        TEST_ASSERT(HasError(duplicated, CompileErrorType::Project_DuplicateModule));
+        TEST_ASSERT(duplicated->dependents.empty());
+        TEST_ASSERT(!notFound->loadError.empty());
+        TEST_ASSERT(notFound->module == nullptr);
+    }
+    {
+        // first and second use each other, third uses the cycle, fourth is alone
+        Project project;
+        auto first = project.AddSource("first.moe", "module first\nusing second\nphrase First(value)\n    result = value\nend\n");
+        auto second = project.AddSource("second.moe", "module second\nusing first\n");
+        auto third = project.AddSource("third.moe", "module third\nusing first\nphrase Third(value)\n    result = value\nend\n");
+        auto fourth = project.AddSource("fourth.moe", "module fourth\nphrase Fourth(value)\n    result = value\nend\n");
+        auto self = project.AddSource("self.moe", "module self\nusing self\n");
+
+        ThreadPool pool(2);
+        TEST_ASSERT(!project.Build(pool));
+        TEST_ASSERT(first->errors.size() == 1);
+        TEST_ASSERT(first->errors[0].errorType == CompileErrorType::Project_CyclicUsing);
+        TEST_ASSERT(first->errors[0].token.value == "second");
+        TEST_ASSERT(second->errors.size() == 1);
+        TEST_ASSERT(second->errors[0].token.value == "first");
+        TEST_ASSERT(HasError(self, CompileErrorType::Project_CyclicUsing));
+        TEST_ASSERT(third->Succeeded());
+
+        // the cycle and its users are not compiled
+        TEST_ASSERT(first->module->functions[0]->body == nullptr);
+        TEST_ASSERT(third->module->functions[0]->body == nullptr);
+        TEST_ASSERT(fourth->module->functions[0]->body != nullptr);
+        TEST_ASSERT(project.criticalPath.size() == 1);
+        TEST_ASSERT(project.units[project.criticalPath[0]] == fourth);
+    }
+}
+
+void TestModuleInterface()
+{
+    string code =
+        "module shapes\n"
+        "using math\n"
+        "tag Round\n"
+        "type Circle\n"
+        "    radius\n"
+        "    center\n"
+        "end\n"
+        "sentence Draw(list shapes)On(assignable canvas)\n"
+        "    canvas = shapes\n"
+        "end\n"
+        "block (body)Repeat(times) : Loop\n"
+        "end\n";
+    auto codeFile = CodeFile::Parse(code);
+    CompileError::List errors;
+    auto module = Module::Parse(codeFile, errors);
+    TEST_ASSERT(errors.empty());
+
+    auto made = ModuleInterface::Make(module, HashBytes(code.data(), code.size()));
+    made->usingHashes = { 233 };
+    auto bytes = made->Serialize();
+    auto loaded = ModuleInterface::Load(bytes.data(), bytes.size());
+    TEST_ASSERT(loaded != nullptr);
+    TEST_ASSERT(loaded->sourceHash == made->sourceHash);
+    TEST_ASSERT(loaded->declarationHash == made->declarationHash);
+    TEST_ASSERT(loaded->usingHashes == made->usingHashes);
+    TEST_ASSERT(loaded->Serialize() == bytes);
+
+    auto & result = loaded->module;
+    TEST_ASSERT(result->name == "shapes");
+    TEST_ASSERT(result->usings.size() == 1 && result->usings[0]->ToLog() == "Using(math)");
+    TEST_ASSERT(result->tags.size() == 1 && result->tags[0]->ToLog() == module->tags[0]->ToLog());
+    TEST_ASSERT(result->types.size() == 1 && result->types[0]->ToLog() == module->types[0]->ToLog());
+    TEST_ASSERT(result->functions.size() == 2);
+    for (size_t i = 0; i < 2; i++)
+    {
+        auto & expected = module->functions[i];
+        auto & actual = result->functions[i];
+        TEST_ASSERT(actual->type == expected->type);
+        TEST_ASSERT(actual->alias == expected->alias);
+        TEST_ASSERT(actual->fragments.size() == expected->fragments.size());
+        for (size_t j = 0; j < actual->fragments.size(); j++)
+        {
+            TEST_ASSERT(actual->fragments[j]->type == expected->fragments[j]->type);
+            TEST_ASSERT(actual->fragments[j]->name == expected->fragments[j]->name);
+        }
+        TEST_ASSERT(actual->arguments.size() == expected->arguments.size());
+        for (size_t j = 0; j < actual->arguments.size(); j++)
+        {
+            TEST_ASSERT(actual->arguments[j]->type == expected->arguments[j]->type);
+            TEST_ASSERT(actual->arguments[j]->name == expected->arguments[j]->name);
+        }
+    }
+    TEST_ASSERT(result->functions[1]->alias == "Loop");
+
+    // only the declarations make the declarationHash
+    string changedBody = code;
+    changedBody.replace(changedBody.find("canvas = shapes"), 15, "shapes = canvas");
+    auto changed = ModuleInterface::Make(Module::Parse(CodeFile::Parse(changedBody), errors), 0);
+    TEST_ASSERT(changed->declarationHash == made->declarationHash);
+
+    // broken interfaces are never loaded
+    for (size_t size = 0; size < bytes.size(); size++)
+        TEST_ASSERT(ModuleInterface::Load(bytes.data(), size) == nullptr);
+    for (size_t i = 0; i < bytes.size(); i++)
+    {
+        string broken = bytes;
+        broken[i] ^= 0x40;
+        auto brokenInterface = ModuleInterface::Load(broken.data(), broken.size());
+        // the hashes of the header and the using hashes are not checked
+        TEST_ASSERT(brokenInterface == nullptr || (i >= 8 && i < 24) || i >= bytes.size() - 8);
+    }
+    TEST_ASSERT(ModuleInterface::Load("minimoe_no_such_file.moei") == nullptr);
+}
+
+void TestProjectCache()
+{
+    string base =
+        "module base\n"
+        "phrase Twice(value)\n"
+        "    result = value * 2\n"
+        "end\n";
+    string user =
+        "module user\n"
+        "using base\n"
+        "phrase Four(value)\n"
+        "    result = Twice(Twice(value))\n"
+        "end\n";
+    std::vector<string> interfacePaths;
+    auto Build = [&](const string & baseCode, bool succeeded){
+        auto project = std::make_shared<Project>();
+        project->cacheDirectory = ".";
+        project->AddSource("cache_test_base.moe", baseCode);
+        project->AddSource("cache_test_user.moe", user);
+        ThreadPool pool(2);
+        TEST_ASSERT(project->Build(pool) == succeeded);
+        for (auto & unit : project->units)
+            interfacePaths.push_back(unit->interfacePath);
+        return project;
+    };
+
+    auto first = Build(base, true);
+    TEST_ASSERT(!first->units[0]->fromCache && !first->units[1]->fromCache);
+
+    // nothing changed, nothing parsed or compiled
+    auto second = Build(base, true);
+    TEST_ASSERT(second->units[0]->fromCache && second->units[1]->fromCache);
+    TEST_ASSERT(second->units[0]->codeFile == nullptr);
+    TEST_ASSERT(second->units[1]->module->functions[0]->body == nullptr);
+    TEST_ASSERT(second->units[1]->dependencies.size() == 1);
+
+    // the declarations of base are the same
+    string changedBody = base;
+    changedBody.replace(changedBody.find("value * 2"), 9, "value + value");
+    auto third = Build(changedBody, true);
+    TEST_ASSERT(!third->units[0]->fromCache && third->units[1]->fromCache);
+
+    // user has to be compiled again when Twice is gone
+    string renamed = base;
+    renamed.replace(renamed.find("Twice"), 5, "Double");
+    auto fourth = Build(renamed, false);
+    TEST_ASSERT(!fourth->units[0]->fromCache && !fourth->units[1]->fromCache);
+    TEST_ASSERT(HasError(fourth->units[1], CompileErrorType::Parser_CanNotResolveSymbol));
+    TEST_ASSERT(fourth->units[0]->Succeeded());
+
+    // and again, for its interface is not saved with errors
+    auto fifth = Build(renamed, false);
+    TEST_ASSERT(fifth->units[0]->fromCache && !fifth->units[1]->fromCache);
+
+    for (auto & path : interfacePaths)
+        std::remove(path.c_str());
+}
+
+void TestProjectCacheStaleChain()
+{
+    // middle0..middle7 use base, and top0..top7 use them
+    std::vector<string> interfacePaths;
+    auto Build = [&](const string & function){
+        auto project = std::make_shared<Project>();
+        project->cacheDirectory = ".";
+        project->AddSource("stale_test_base.moe", "module base\nphrase " + function + "(value)\n    result = value\nend\n");
+        for (size_t i = 0; i < 8; i++)
+        {
+            string n = std::to_string(i);
+            project->AddSource("stale_test_middle" + n + ".moe",
+                "module middle" + n + "\nusing base\nphrase Middle" + n + "(value)\n    result = value\nend\n");
+            project->AddSource("stale_test_top" + n + ".moe",
+                "module top" + n + "\nusing middle" + n + "\nphrase Top" + n + "(value)\n    result = Middle" + n + "(value)\nend\n");
+        }
+        ThreadPool pool(4);
+        TEST_ASSERT(project->Build(pool));
+        for (auto & unit : project->units)
+            interfacePaths.push_back(unit->interfacePath);
+        return project;
+    };
+
+    Build("Base");
+    // the declarations of base are changed, the middles are compiled again, their declarations are the same
+    auto project = Build("ChangedBase");
+    TEST_ASSERT(!project->units[0]->fromCache);
+    for (size_t i = 1; i < project->units.size(); i += 2)
+    {
+        TEST_ASSERT(!project->units[i]->fromCache);
+        TEST_ASSERT(project->units[i + 1]->fromCache);
+    }
+
+    for (auto & path : interfacePaths)
+        std::remove(path.c_str());
+}
+
+void InvokeProjectTest()
+{
+    TestProjectOrder();
+    TestProjectErrors();
+    TestModuleInterface();
+    TestProjectCache();
+    TestProjectCacheStaleChain();
+    std::cout << "Project Test Complete" << std::endl;
+}
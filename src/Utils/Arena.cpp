@@ -0,0 +1,39 @@
+#include <cstdint>
+
+#include "Utils/Arena.h"
+#include "Utils/Debug.h"
+
+namespace minimoe
+{
+    Arena::Arena(size_t _blockSize)
+        : blockSize(_blockSize), cursor(nullptr), limit(nullptr), allocatedBytes(0)
+    {}
+
+    Arena::~Arena()
+    {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+            it->destroy(it->object);
+    }
+
+    void * Arena::Allocate(size_t size, size_t alignment)
+    {
+        DEBUGCHECK((alignment & (alignment - 1)) == 0);
+        auto Align = [alignment](char * p){
+            return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~(alignment - 1));
+        };
+
+        char * head = cursor == nullptr ? nullptr : Align(cursor);
+        if (head == nullptr || head + size > limit)
+        {
+            // the ones larger than a block get a block of their own
+            size_t newBlockSize = size + alignment > blockSize ? size + alignment : blockSize;
+            blocks.emplace_back(new char[newBlockSize]);
+            cursor = blocks.back().get();
+            limit = cursor + newBlockSize;
+            head = Align(cursor);
+        }
+        cursor = head + size;
+        allocatedBytes += size;
+        return head;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef MINIMOE_ARENA_H
+#define MINIMOE_ARENA_H
+
+#include <memory>
+#include <vector>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace minimoe
+{
+    // bump allocator, everything allocated is freed at once when the arena is destroyed.
+    // the objects created by New are destroyed in the reverse order of creation
+    class Arena
+    {
+    public:
+        typedef std::shared_ptr<Arena> Ptr;
+
+        explicit Arena(size_t _blockSize = 1 << 16);
+        ~Arena();
+        Arena(const Arena &) = delete;
+        Arena & operator=(const Arena &) = delete;
+
+        void * Allocate(size_t size, size_t alignment);
+
+        template<class T, class... Params>
+        T * New(Params &&... params)
+        {
+            T * object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Params>(params)...);
+            if (!std::is_trivially_destructible<T>::value)
+                destructors.push_back({ object, &Destroy<T> });
+            return object;
+        }
+
+        // bytes taken by the objects, without the unused space at the end of the blocks
+        size_t AllocatedBytes() const { return allocatedBytes; }
+
+    private:
+        struct Destructor
+        {
+            void * object;
+            void (*destroy)(void * object);
+        };
+
+        template<class T>
+        static void Destroy(void * object)
+        {
+            static_cast<T*>(object)->~T();
+        }
+
+        size_t blockSize;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char * cursor;
+        char * limit;
+        size_t allocatedBytes;
+        std::vector<Destructor> destructors;
+    };
+}
+
+#endif
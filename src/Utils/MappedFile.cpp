@@ -0,0 +1,114 @@
+#include "Utils/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace minimoe
+{
+    using std::string;
+
+#ifdef _WIN32
+    MappedFile::MappedFile()
+        : content(nullptr), length(0), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+    {}
+
+    MappedFile::~MappedFile()
+    {
+        if (content) UnmapViewOfFile(content);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    }
+
+    MappedFile::Ptr MappedFile::Open(const string & path, string & errorMsg)
+    {
+        Ptr mappedFile(new MappedFile());
+        mappedFile->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (mappedFile->file == INVALID_HANDLE_VALUE)
+        {
+            errorMsg = "can't open file: " + path;
+            return nullptr;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(mappedFile->file, &fileSize))
+        {
+            errorMsg = "can't get the size of file: " + path;
+            return nullptr;
+        }
+        mappedFile->length = static_cast<size_t>(fileSize.QuadPart);
+        // an empty file can't be mapped, and there is nothing to map
+        if (mappedFile->length == 0)
+            return mappedFile;
+
+        mappedFile->mapping = CreateFileMappingA(mappedFile->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mappedFile->mapping)
+        {
+            errorMsg = "can't map file: " + path;
+            return nullptr;
+        }
+        mappedFile->content = static_cast<const char *>(MapViewOfFile(mappedFile->mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!mappedFile->content)
+        {
+            errorMsg = "can't map file: " + path;
+            return nullptr;
+        }
+        return mappedFile;
+    }
+#else
+    MappedFile::MappedFile()
+        : content(nullptr), length(0)
+    {}
+
+    MappedFile::~MappedFile()
+    {
+        if (content) munmap(const_cast<char *>(content), length);
+    }
+
+    MappedFile::Ptr MappedFile::Open(const string & path, string & errorMsg)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            errorMsg = "can't open file: " + path + ", " + std::strerror(errno);
+            return nullptr;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == -1)
+        {
+            errorMsg = "can't get the size of file: " + path + ", " + std::strerror(errno);
+            close(fd);
+            return nullptr;
+        }
+
+        Ptr mappedFile(new MappedFile());
+        mappedFile->length = static_cast<size_t>(fileStat.st_size);
+        // an empty file can't be mapped, and there is nothing to map
+        if (mappedFile->length != 0)
+        {
+            void * address = mmap(nullptr, mappedFile->length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED)
+            {
+                errorMsg = "can't map file: " + path + ", " + std::strerror(errno);
+                close(fd);
+                return nullptr;
+            }
+            // the lexer goes through the file from the beginning to the end
+            madvise(address, mappedFile->length, MADV_SEQUENTIAL);
+            mappedFile->content = static_cast<const char *>(address);
+        }
+        // the mapping keeps the file alive
+        close(fd);
+        return mappedFile;
+    }
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef MINIMOE_MAPPED_FILE_H
+#define MINIMOE_MAPPED_FILE_H
+
+#include <string>
+#include <memory>
+
+namespace minimoe
+{
+    // a file mapped read only into memory, the content stays valid until it's destroyed
+    class MappedFile
+    {
+    public:
+        typedef std::shared_ptr<MappedFile> Ptr;
+
+        // return nullptr and set errorMsg if the file can't be mapped
+        static Ptr Open(const std::string & path, std::string & errorMsg);
+
+        ~MappedFile();
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        const char * data() const { return content; }
+        size_t size() const { return length; }
+
+    private:
+        MappedFile();
+
+        const char * content;
+        size_t length;
+#ifdef _WIN32
+        void * file;
+        void * mapping;
+#endif
+    };
+}
+
+#endif
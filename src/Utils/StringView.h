@@ -0,0 +1,79 @@
+#ifndef MINIMOE_STRING_VIEW_H
+#define MINIMOE_STRING_VIEW_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+namespace minimoe
+{
+    // a reference to a piece of text owned by someone else, the owner must outlive it
+    class StringView
+    {
+    public:
+        StringView()
+            : head(nullptr), length(0)
+        {}
+        StringView(const char * _head, size_t _length)
+            : head(_head), length(_length)
+        {}
+        StringView(const char * s)
+            : head(s), length(std::strlen(s))
+        {}
+        StringView(const std::string & s)
+            : head(s.data()), length(s.size())
+        {}
+
+        const char * data() const { return head; }
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+        const char * begin() const { return head; }
+        const char * end() const { return head + length; }
+        char operator[](size_t i) const { return head[i]; }
+
+        std::string ToString() const { return std::string(head, length); }
+
+        bool operator==(const StringView & other) const
+        {
+            return length == other.length
+                && (length == 0 || std::memcmp(head, other.head, length) == 0);
+        }
+        bool operator!=(const StringView & other) const { return !(*this == other); }
+
+    private:
+        const char * head;
+        size_t length;
+    };
+
+    inline bool operator==(const std::string & lhs, const StringView & rhs) { return StringView(lhs) == rhs; }
+    inline bool operator==(const char * lhs, const StringView & rhs) { return StringView(lhs) == rhs; }
+    inline bool operator!=(const std::string & lhs, const StringView & rhs) { return !(lhs == rhs); }
+    inline bool operator!=(const char * lhs, const StringView & rhs) { return !(lhs == rhs); }
+
+    // for the hash containers keyed by StringView, mixes 8 chars at a time since most keys are identifiers
+    struct StringViewHash
+    {
+        size_t operator()(const StringView & s) const
+        {
+            uint64_t hash = s.size() * 0x9E3779B97F4A7C15ull;
+            const char * it = s.begin();
+            size_t rest = s.size();
+            for (; rest >= 8; it += 8, rest -= 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, it, 8);
+                hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+                hash ^= hash >> 32;
+            }
+            // the chars of an empty view may be nullptr, which memcpy never takes even for 0 bytes
+            uint64_t tail = 0;
+            if (rest != 0)
+                std::memcpy(&tail, it, rest);
+            hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ull;
+            hash ^= hash >> 29;
+            return static_cast<size_t>(hash);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef MINIMOE_THREAD_POOL_H
+#define MINIMOE_THREAD_POOL_H
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace minimoe
+{
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency())
+            : stopping(false)
+        {
+            if (threadCount == 0) threadCount = 1;
+            for (size_t i = 0; i < threadCount; i++)
+                workers.emplace_back([this](){ WorkerLoop(); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeUp.notify_all();
+            for (auto & worker : workers)
+                worker.join();
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        size_t Size() const { return workers.size(); }
+
+        // run task on one of the workers, the future gets its result or exception
+        template<class Task>
+        auto Submit(Task task) -> std::future<decltype(task())>
+        {
+            typedef decltype(task()) Result;
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+            auto future = packaged->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push([packaged](){ (*packaged)(); });
+            }
+            wakeUp.notify_one();
+            return future;
+        }
+
+        // run body(0) to body(count - 1) on the workers and the calling thread, return when all of them are done.
+        // the calling thread runs the ones no worker has started instead of waiting for them,
+        // so it's fine to call it from a task of the same pool.
+        // the first exception thrown by body is thrown again here, the indexes after it may not be run
+        template<class Body>
+        void ParallelFor(size_t count, Body body)
+        {
+            struct State
+            {
+                std::atomic<size_t> next;
+                size_t finished;
+                std::exception_ptr exception;
+                std::atomic<bool> failed;
+                std::mutex mutex;
+                std::condition_variable allFinished;
+            };
+            auto state = std::make_shared<State>();
+            state->next = 0;
+            state->finished = 0;
+            state->failed = false;
+            // the helpers submitted but started after all are done only find nothing left to run.
+            // every index taken is finished even if body throws, or the calling thread would wait forever
+            auto run = [state, count, &body](){
+                size_t done = 0;
+                std::exception_ptr exception;
+                size_t i;
+                while ((i = state->next++) < count)
+                {
+                    done++;
+                    if (state->failed)
+                        continue;
+                    try
+                    {
+                        body(i);
+                    }
+                    catch (...)
+                    {
+                        exception = std::current_exception();
+                        state->failed = true;
+                    }
+                }
+                if (done == 0)
+                    return;
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (exception && !state->exception)
+                    state->exception = exception;
+                state->finished += done;
+                if (state->finished == count)
+                    state->allFinished.notify_all();
+            };
+            for (size_t i = 1; i < count && i <= workers.size(); i++)
+                Submit(run);
+            run();
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->allFinished.wait(lock, [&](){ return state->finished == count; });
+            if (state->exception)
+                std::rethrow_exception(state->exception);
+        }
+
+    private:
+        void WorkerLoop()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wakeUp.wait(lock, [this](){ return stopping || !tasks.empty(); });
+                    if (tasks.empty())
+                        return; // stopping and nothing left
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        bool stopping;
+    };
+}
+
+#endif